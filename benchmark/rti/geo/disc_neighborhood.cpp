@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <sys/resource.h>
+
+#include "rti/geo/disc_neighborhood.hpp"
+#include "rti/util/synthetic_point_cloud.hpp"
+#include "rti/util/utils.hpp"
+
+// Benchmarks of the construction of disc neighborhoods.
+//
+// Reported counters:
+//   avg-degree, max-degree: number of neighbors per disc
+//   nbhd-bytes: memory held by the neighborhood (including unused capacity)
+//   peak-rss-bytes: peak resident set size of the process so far. This value
+//     never decreases; run a single case (--benchmark_filter) to attribute it.
+
+using namespace rti;
+using nt = float;
+using points_t = std::vector<util::quadruple<nt> >;
+
+// Random points on the plane z == 0 in the unit square. The radius is chosen
+// such that the density equals the one of a regular grid with spacing == radius.
+static
+points_t uniform_cloud(size_t pNumPoints)
+{
+  auto rng = std::mt19937_64 {1234};
+  auto dist = std::uniform_real_distribution<nt> {0, 1};
+  auto radius = (nt) (1 / std::sqrt((double) pNumPoints));
+  auto result = points_t {};
+  result.reserve(pNumPoints);
+  for (size_t idx = 0; idx < pNumPoints; ++idx) {
+    result.push_back({dist(rng), dist(rng), 0, radius});
+  }
+  return result;
+}
+
+// Half of the points uniform on the unit square, the other half in Gaussian
+// clusters on the same plane.
+static
+points_t clustered_cloud(size_t pNumPoints)
+{
+  auto numclusters = 64u; // magic number
+  auto sigma = (nt) 0.02; // magic number
+  auto rng = std::mt19937_64 {1234};
+  auto udist = std::uniform_real_distribution<nt> {0, 1};
+  auto ndist = std::normal_distribution<nt> {0, sigma};
+  auto centers = std::vector<util::pair<nt> > {};
+  for (size_t idx = 0; idx < numclusters; ++idx) {
+    centers.push_back({udist(rng), udist(rng)});
+  }
+  auto radius = (nt) (1 / std::sqrt((double) pNumPoints));
+  auto result = points_t {};
+  result.reserve(pNumPoints);
+  for (size_t idx = 0; idx < pNumPoints; ++idx) {
+    if (idx % 2 == 0) {
+      result.push_back({udist(rng), udist(rng), 0, radius});
+      continue;
+    }
+    auto const& cc = centers[idx % numclusters];
+    result.push_back({cc[0] + ndist(rng), cc[1] + ndist(rng), 0, radius});
+  }
+  return result;
+}
+
+// Half of the points lie exactly on the plane x == 0.5, which is the first
+// pivot plane of the divide-and-conquer builder; the other half is uniform
+// in the unit cube.
+static
+points_t degenerate_cloud(size_t pNumPoints)
+{
+  auto rng = std::mt19937_64 {1234};
+  auto dist = std::uniform_real_distribution<nt> {0, 1};
+  auto radius = (nt) (1 / std::sqrt((double) pNumPoints));
+  auto result = points_t {};
+  result.reserve(pNumPoints);
+  for (size_t idx = 0; idx < pNumPoints; ++idx) {
+    auto xx = idx % 2 == 0 ? (nt) 0.5 : dist(rng);
+    result.push_back({xx, dist(rng), dist(rng), radius});
+  }
+  // Make sure that the bounding box is [0, 1]^3 such that the pivot is 0.5.
+  result.push_back({0, 0, 0, radius});
+  result.push_back({1, 1, 1, radius});
+  return result;
+}
+
+static
+points_t trench_cloud(size_t pNumPoints)
+{
+  return bench::synthetic_point_cloud<nt>::trench(pNumPoints).points;
+}
+
+static
+util::pair<util::triple<nt> > bounding_box(points_t const& pPoints)
+{
+  auto result = util::pair<util::triple<nt> >
+    {util::triple<nt> {std::numeric_limits<nt>::max(), std::numeric_limits<nt>::max(), std::numeric_limits<nt>::max()},
+     util::triple<nt> {std::numeric_limits<nt>::lowest(), std::numeric_limits<nt>::lowest(), std::numeric_limits<nt>::lowest()}};
+  for (auto const& pp : pPoints) {
+    for (size_t idx = 0; idx < 3; ++idx) {
+      result[0][idx] = std::min(result[0][idx], pp[idx]);
+      result[1][idx] = std::max(result[1][idx], pp[idx]);
+    }
+  }
+  return result;
+}
+
+static
+void report(benchmark::State& pState, geo::disc_neighborhood<nt>& pNbhd)
+{
+  auto sum = 0.0;
+  auto max = (size_t) 0;
+  auto bytes = (double) pNbhd.size() * sizeof(std::vector<size_t>);
+  for (size_t idx = 0; idx < pNbhd.size(); ++idx) {
+    auto const& nn = pNbhd.get_neighbors(idx);
+    sum += nn.size();
+    max = std::max(max, nn.size());
+    bytes += nn.capacity() * sizeof(size_t);
+  }
+  auto usage = rusage {};
+  getrusage(RUSAGE_SELF, &usage);
+  pState.counters["points"] = (double) pNbhd.size();
+  pState.counters["avg-degree"] = pNbhd.size() == 0 ? 0 : sum / pNbhd.size();
+  pState.counters["max-degree"] = (double) max;
+  pState.counters["nbhd-bytes"] = bytes;
+  pState.counters["peak-rss-bytes"] = (double) usage.ru_maxrss * 1024;
+  pState.counters["points/s"] = benchmark::Counter
+    ((double) pNbhd.size() * pState.iterations(), benchmark::Counter::kIsRate);
+}
+
+static
+void disc_neighborhood_divide_and_conquer(benchmark::State& pState, points_t (*pGenerator) (size_t))
+{
+  auto points = pGenerator((size_t) pState.range(0));
+  auto bdbox = bounding_box(points);
+  auto nbhd = geo::disc_neighborhood<nt> {};
+  for (auto _ : pState) {
+    nbhd = geo::disc_neighborhood<nt> {};
+    nbhd.setup_neighborhood(points, bdbox[0], bdbox[1]);
+    benchmark::ClobberMemory();
+  }
+  report(pState, nbhd);
+}
+
+static
+void disc_neighborhood_naive_1(benchmark::State& pState, points_t (*pGenerator) (size_t))
+{
+  auto points = pGenerator((size_t) pState.range(0));
+  auto nbhd = geo::disc_neighborhood<nt> {};
+  for (auto _ : pState) {
+    nbhd = geo::disc_neighborhood<nt> {};
+    nbhd.setup_neighborhood_naive(points);
+    benchmark::ClobberMemory();
+  }
+  report(pState, nbhd);
+}
+
+static
+void disc_neighborhood_naive_2(benchmark::State& pState, points_t (*pGenerator) (size_t))
+{
+  auto points = pGenerator((size_t) pState.range(0));
+  auto nbhd = geo::disc_neighborhood<nt> {};
+  for (auto _ : pState) {
+    nbhd = geo::disc_neighborhood<nt> {};
+    nbhd.setup_neighborhood_naive_2(points);
+    benchmark::ClobberMemory();
+  }
+  report(pState, nbhd);
+}
+
+#define RTI_NBHD_BENCHMARKS(cloud)                                      \
+  BENCHMARK_CAPTURE(disc_neighborhood_divide_and_conquer, cloud, cloud##_cloud) \
+  ->RangeMultiplier(10)->Range(1000, 10 * 1000 * 1000)->UseRealTime()->Unit(benchmark::kMillisecond); \
+  BENCHMARK_CAPTURE(disc_neighborhood_naive_1, cloud, cloud##_cloud)    \
+  ->RangeMultiplier(10)->Range(1000, 100 * 1000)->UseRealTime()->Unit(benchmark::kMillisecond); \
+  BENCHMARK_CAPTURE(disc_neighborhood_naive_2, cloud, cloud##_cloud)    \
+  ->RangeMultiplier(10)->Range(1000, 100 * 1000)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+RTI_NBHD_BENCHMARKS(uniform)
+RTI_NBHD_BENCHMARKS(clustered)
+RTI_NBHD_BENCHMARKS(degenerate)
+RTI_NBHD_BENCHMARKS(trench)
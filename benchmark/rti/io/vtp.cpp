@@ -0,0 +1,164 @@
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <embree3/rtcore.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLPolyDataWriter.h>
+
+#include "rti/geo/point_cloud_disc_geometry.hpp"
+#include "rti/io/vtp_point_cloud_reader.hpp"
+#include "rti/io/vtp_writer.hpp"
+#include "rti/trace/hit_accumulator.hpp"
+#include "rti/util/synthetic_point_cloud.hpp"
+
+// Benchmarks of reading point clouds with io::vtp_point_cloud_reader and of
+// writing results with io::vtp_writer. The clouds are generated in memory and
+// written to the temporary directory of the system.
+//
+// Arguments: number of points and the data mode of the file (0: ascii,
+// 1: binary, 2: appended). The written files are compressed with zlib unless
+// the data mode is ascii.
+
+using namespace rti;
+using nt = float;
+using cloud_t = bench::synthetic_point_cloud<nt>;
+
+enum data_mode : int { ASCII = 0, BINARY, APPENDED };
+
+static
+char const* data_mode_name(int pMode)
+{
+  switch (pMode) {
+  case ASCII: return "ascii";
+  case BINARY: return "binary";
+  default: return "appended";
+  }
+}
+
+static
+std::string temp_file_name(std::string const& pName)
+{
+  return (std::filesystem::temp_directory_path() / ("rti-bench-" + pName + ".vtp")).string();
+}
+
+// Writes a cloud in the layout which vtp_point_cloud_reader expects
+static
+void write_input_file(cloud_t const& pCloud, std::string const& pFilename, int pDataMode)
+{
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  auto cells = vtkSmartPointer<vtkCellArray>::New();
+  auto normals = vtkSmartPointer<vtkDoubleArray>::New();
+  normals->SetNumberOfComponents(3);
+  normals->SetNumberOfTuples(pCloud.size());
+  auto radii = vtkSmartPointer<vtkDoubleArray>::New();
+  radii->SetNumberOfComponents(1);
+  radii->SetNumberOfTuples(pCloud.size());
+  for (size_t idx = 0; idx < pCloud.size(); ++idx) {
+    auto const& pp = pCloud.points[idx];
+    auto const& nn = pCloud.normals[idx];
+    auto pointid = points->InsertNextPoint(pp[0], pp[1], pp[2]);
+    cells->InsertNextCell(1, &pointid);
+    double normal[3] {nn[0], nn[1], nn[2]};
+    double radius[1] {pp[3]};
+    normals->SetTuple(idx, normal);
+    radii->SetTuple(idx, radius);
+  }
+  auto polydata = vtkSmartPointer<vtkPolyData>::New();
+  polydata->SetPoints(points);
+  polydata->SetVerts(cells);
+  polydata->GetCellData()->SetNormals(normals);
+  radii->SetName("radius");
+  polydata->GetCellData()->AddArray(radii);
+  auto writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+  writer->SetFileName(pFilename.c_str());
+  writer->SetInputData(polydata);
+  switch (pDataMode) {
+  case ASCII: writer->SetDataModeToAscii(); break;
+  case BINARY: writer->SetDataModeToBinary(); break;
+  default: writer->SetDataModeToAppended(); break;
+  }
+  writer->Write();
+}
+
+static
+void set_io_counters(benchmark::State& pState, size_t pNumPoints, std::string const& pFilename)
+{
+  auto filesize = std::filesystem::file_size(pFilename);
+  pState.SetBytesProcessed(pState.iterations() * filesize);
+  pState.counters["file-bytes"] = (double) filesize;
+  pState.counters["points/s"] = benchmark::Counter
+    ((double) pState.iterations() * pNumPoints, benchmark::Counter::kIsRate);
+}
+
+static
+void vtp_point_cloud_reader(benchmark::State& pState)
+{
+  auto numpoints = (size_t) pState.range(0);
+  auto datamode = (int) pState.range(1);
+  auto cloud = cloud_t::trench(numpoints);
+  auto filename = temp_file_name(std::string {"input-"} + data_mode_name(datamode));
+  write_input_file(cloud, filename, datamode);
+  for (auto _ : pState) {
+    auto reader = io::vtp_point_cloud_reader<nt> {filename};
+    benchmark::DoNotOptimize(&reader);
+  }
+  pState.SetLabel(data_mode_name(datamode));
+  set_io_counters(pState, cloud.size(), filename);
+  std::filesystem::remove(filename);
+}
+
+static
+void vtp_writer(benchmark::State& pState)
+{
+  auto numpoints = (size_t) pState.range(0);
+  auto datamode = (int) pState.range(1);
+  auto cloud = cloud_t::trench(numpoints);
+  auto options = io::vtp_write_options {};
+  options.format =
+    datamode == ASCII ? io::vtp_write_options::format_type::ASCII :
+    datamode == BINARY ? io::vtp_write_options::format_type::BINARY :
+    io::vtp_write_options::format_type::APPENDED;
+  auto device = rtcNewDevice("");
+  auto geometry = geo::point_cloud_disc_geometry<nt> {device, cloud.points, cloud.normals};
+  auto hitacc = trace::hit_accumulator<nt> {geometry.get_num_primitives()};
+  auto rng = std::mt19937_64 {1234};
+  auto primdist = std::uniform_int_distribution<unsigned int> {0, (unsigned int) geometry.get_num_primitives() - 1};
+  auto valuedist = std::uniform_real_distribution<nt> {0, 1};
+  for (size_t idx = 0; idx < 8 * geometry.get_num_primitives(); ++idx) {
+    hitacc.use(primdist(rng), valuedist(rng));
+  }
+  auto areas = std::vector<nt> (geometry.get_num_primitives(), 1);
+  hitacc.set_exposed_areas(areas);
+  auto filename = temp_file_name(std::string {"output-"} + data_mode_name(datamode));
+  for (auto _ : pState) {
+    io::vtp_writer<nt>::write(geometry, hitacc, filename, {{"benchmark", "vtp_writer"}}, options);
+  }
+  pState.SetLabel(data_mode_name(datamode));
+  set_io_counters(pState, cloud.size(), filename);
+  std::filesystem::remove(filename);
+  rtcReleaseDevice(device);
+}
+
+static
+void data_mode_arguments(benchmark::internal::Benchmark* pBenchmark)
+{
+  for (auto numpoints : {10 * 1000, 100 * 1000, 1000 * 1000, 10 * 1000 * 1000}) {
+    for (auto datamode : {ASCII, BINARY, APPENDED}) {
+      pBenchmark->Args({numpoints, datamode});
+    }
+  }
+}
+
+BENCHMARK(vtp_point_cloud_reader)
+->Apply(data_mode_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(vtp_writer)
+->Apply(data_mode_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,121 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include "rti/service/client.hpp"
+#include "rti/service/server.hpp"
+#include "rti/util/logger.hpp"
+#include "rti/util/synthetic_point_cloud.hpp"
+
+// Throughput of the tracing service (rti-service) in requests per second.
+//
+// Arguments: number of discs, number of rays per request, and the mode:
+// DIRECT calls a warm rti::device in the same process (the lower bound),
+// SOCKET sends the geometry with every request through the Unix socket, and
+// SOCKET_REUSE sends it once and then traces the kept scene
+// (protocol::sReuseGeometry). The difference between DIRECT and SOCKET is
+// the cost of the transfers.
+
+using namespace rti;
+using nt = float;
+using cloud_t = bench::synthetic_point_cloud<nt>;
+
+enum service_mode : int { DIRECT = 0, SOCKET, SOCKET_REUSE };
+
+static
+service::protocol::request make_request(size_t pNumDiscs, size_t pNumRays)
+{
+  auto cloud = cloud_t::trench(pNumDiscs);
+  auto request = service::protocol::request {};
+  request.xcond = service::protocol::sPeriodic;
+  request.ycond = service::protocol::sPeriodic;
+  request.stickingc = 0.5f;
+  request.numrays = pNumRays;
+  request.points.reserve(3 * cloud.size());
+  request.normals.reserve(3 * cloud.size());
+  for (size_t idx = 0; idx < cloud.size(); ++idx) {
+    for (size_t dim = 0; dim < 3; ++dim) {
+      request.points.push_back(cloud.points[idx][dim]);
+      request.normals.push_back(cloud.normals[idx][dim]);
+    }
+  }
+  // The radius of the discs is the grid spacing
+  request.spacings = {cloud.points[0][3]};
+  return request;
+}
+
+static
+void service_throughput(benchmark::State& pState)
+{
+  auto numdiscs = (size_t) pState.range(0);
+  auto numrays = (size_t) pState.range(1);
+  auto mode = (int) pState.range(2);
+  auto loglevels = util::logger::get_levels();
+  util::logger::set_levels(util::log_level::NONE);
+  auto request = make_request(numdiscs, numrays);
+
+  if (mode == DIRECT) {
+    auto device = service::server::device_type {};
+    service::sticking_particle::sStickingC = request.stickingc;
+    device.set_x(bound_condition::PERIODIC);
+    device.set_y(bound_condition::PERIODIC);
+    device.set_number_of_rays(numrays);
+    for (auto _ : pState) {
+      device.set_points(request.points.data(), numdiscs);
+      device.set_normals(request.normals.data(), numdiscs);
+      device.set_grid_spacing(request.spacings[0]);
+      device.run();
+      benchmark::DoNotOptimize(device.get_mc_estimates_view().data());
+    }
+  } else {
+    auto socketpath = "/tmp/rti-service-benchmark." + std::to_string(::getpid()) + ".socket";
+    auto server = service::server {socketpath};
+    if ( ! server.is_valid()) {
+      pState.SkipWithError("cannot listen on the socket");
+      util::logger::set_levels(loglevels);
+      return;
+    }
+    auto serverthread = std::thread {[&server] { server.serve(); }};
+    {
+      auto client = service::client {socketpath};
+      auto response = service::protocol::response {};
+      if (mode == SOCKET_REUSE) {
+        // Sends the geometry; the following requests reuse it
+        client.trace(request, response);
+        request.flags = service::protocol::sReuseGeometry;
+      }
+      for (auto _ : pState) {
+        if ( ! client.trace(request, response) || response.stat != service::protocol::status::OK) {
+          pState.SkipWithError("request failed");
+          break;
+        }
+        benchmark::DoNotOptimize(response.mcestimates.data());
+      }
+    }
+    server.stop();
+    serverthread.join();
+  }
+  pState.SetItemsProcessed(pState.iterations());
+  pState.counters["rays/s"] = benchmark::Counter
+    ((double) numrays * pState.iterations(), benchmark::Counter::kIsRate);
+  util::logger::set_levels(loglevels);
+}
+
+static
+void service_arguments(benchmark::internal::Benchmark* pBenchmark)
+{
+  for (auto numdiscs : {10 * 1000, 100 * 1000}) {
+    for (auto numrays : {10 * 1000, 1000 * 1000}) {
+      for (auto mode : {DIRECT, SOCKET, SOCKET_REUSE}) {
+        pBenchmark->Args({numdiscs, numrays, mode});
+      }
+    }
+  }
+}
+
+BENCHMARK(service_throughput)
+->Apply(service_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
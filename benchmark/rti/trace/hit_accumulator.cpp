@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <omp.h>
+
+#include "rti/trace/epoch_reducer.hpp"
+#include "rti/trace/hit_accumulator.hpp"
+
+// Benchmarks of the hit accumulator: the per-hit update (use()) and the
+// reduction of the per-thread instances epoch by epoch through
+// trace::epoch_reducer (as in trace::tracer).
+//
+// Arguments: number of primitives, number of threads.
+
+using namespace rti;
+using nt = float;
+
+static auto numhits = (size_t) 1 << 22;
+static auto numepochs = (uint64_t) 8;
+
+enum class hit_distribution { UNIFORM, CLUSTERED, POWER_LAW };
+
+class hit_stream {
+public:
+  std::vector<unsigned int> primids;
+  std::vector<nt> values;
+};
+
+// Uniform: every primitive is equally likely.
+// Clustered: hits come in runs of primitives with nearby IDs (as neighboring
+//   discs often have nearby IDs in our inputs).
+// Power law: the frequency of the k-th most frequent primitive is proportional
+//   to k^(-1); the frequent primitives are scattered over the ID range.
+static
+hit_stream make_hit_stream(hit_distribution pDistribution, size_t pNumPrims)
+{
+  auto rng = std::mt19937_64 {1234};
+  auto uniform = std::uniform_int_distribution<size_t> {0, pNumPrims - 1};
+  auto unit = std::uniform_real_distribution<double> {0, 1};
+  auto result = hit_stream {};
+  result.primids.reserve(numhits);
+  result.values.reserve(numhits);
+  auto permutation = std::vector<unsigned int> (pNumPrims);
+  std::iota(permutation.begin(), permutation.end(), 0);
+  std::shuffle(permutation.begin(), permutation.end(), rng);
+  auto center = (size_t) 0;
+  for (size_t idx = 0; idx < numhits; ++idx) {
+    auto id = (size_t) 0;
+    switch (pDistribution) {
+    case hit_distribution::UNIFORM:
+      id = uniform(rng);
+      break;
+    case hit_distribution::CLUSTERED: {
+      auto clustersize = 64; // magic number
+      if (idx % 8 == 0) {
+        center = uniform(rng);
+      }
+      auto offset = (long long) (unit(rng) * clustersize) - clustersize / 2;
+      id = (size_t) std::min<long long>(std::max<long long>(0, (long long) center + offset), pNumPrims - 1);
+      break;
+    }
+    case hit_distribution::POWER_LAW:
+      // Inverse transform sampling of the (continuous) distribution with density ~ 1/k on [1, n]
+      id = permutation[std::min(pNumPrims - 1, (size_t) std::pow((double) pNumPrims, unit(rng)) - 1)];
+      break;
+    }
+    result.primids.push_back((unsigned int) id);
+    result.values.push_back((nt) unit(rng));
+  }
+  return result;
+}
+
+static
+void hit_accumulator_use(benchmark::State& pState, hit_distribution pDistribution)
+{
+  auto numprims = (size_t) pState.range(0);
+  auto numthreads = (int) pState.range(1);
+  auto stream = make_hit_stream(pDistribution, numprims);
+  auto accumulators = std::vector<trace::hit_accumulator<nt> > (numthreads, trace::hit_accumulator<nt> {numprims});
+  for (auto _ : pState) {
+    #pragma omp parallel num_threads(numthreads)
+    {
+      auto& acc = accumulators[omp_get_thread_num()];
+      #pragma omp for
+      for (size_t idx = 0; idx < stream.primids.size(); ++idx) {
+        acc.use(stream.primids[idx], stream.values[idx]);
+      }
+    }
+  }
+  benchmark::DoNotOptimize(accumulators.front().get_cnts_sum());
+  pState.SetItemsProcessed(pState.iterations() * stream.primids.size());
+  pState.counters["hits/s"] = benchmark::Counter
+    ((double) pState.iterations() * stream.primids.size(), benchmark::Counter::kIsRate);
+}
+
+static
+void hit_accumulator_reduce(benchmark::State& pState)
+{
+  auto numprims = (size_t) pState.range(0);
+  auto numthreads = (int) pState.range(1);
+
+  for (auto _ : pState) {
+    auto reducer = trace::epoch_reducer<nt> {numprims, (size_t) numthreads};
+    #pragma omp parallel num_threads(numthreads)
+    {
+      auto threadnum = (size_t) omp_get_thread_num();
+      auto progress = trace::thread_progress {};
+      // Allocated by the thread itself, as in the tracer
+      auto acc = std::make_unique<trace::hit_accumulator<nt> >(numprims);
+      for (uint64_t epoch = 0; epoch < numepochs; ++epoch) {
+        // One hit per thread and epoch such that the instances are touched
+        acc->use((unsigned int) threadnum % numprims, 1);
+        acc = reducer.submit(threadnum, epoch, std::move(acc), progress, epoch + 1 < numepochs);
+      }
+    }
+    auto hitacc = reducer.take_result();
+    benchmark::DoNotOptimize(hitacc->get_cnts_sum());
+  }
+  pState.SetBytesProcessed
+    (pState.iterations() * numepochs * numthreads * numprims * (6 * sizeof(double) + sizeof(size_t)));
+}
+
+static
+void hit_accumulator_arguments(benchmark::internal::Benchmark* pBenchmark)
+{
+  auto threads = std::vector<int> {};
+  for (auto tt = 1; tt < omp_get_max_threads(); tt *= 2) {
+    threads.push_back(tt);
+  }
+  threads.push_back(omp_get_max_threads());
+  for (auto numprims : {10 * 1000, 1000 * 1000, 10 * 1000 * 1000}) {
+    for (auto numthreads : threads) {
+      pBenchmark->Args({numprims, numthreads});
+    }
+  }
+}
+
+BENCHMARK_CAPTURE(hit_accumulator_use, uniform, hit_distribution::UNIFORM)
+->Apply(hit_accumulator_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(hit_accumulator_use, clustered, hit_distribution::CLUSTERED)
+->Apply(hit_accumulator_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(hit_accumulator_use, power_law, hit_distribution::POWER_LAW)
+->Apply(hit_accumulator_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(hit_accumulator_reduce)
+->Apply(hit_accumulator_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,196 @@
+#include <map>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include <embree3/rtcore.h>
+#include <omp.h>
+#include <pmmintrin.h>
+#include <xmmintrin.h>
+
+#include "rti/geo/boundary_x_y.hpp"
+#include "rti/geo/point_cloud_disc_geometry.hpp"
+#include "rti/particle/i_particle.hpp"
+#include "rti/ray/cosine_direction_z.hpp"
+#include "rti/ray/rectangle_origin_z.hpp"
+#include "rti/ray/source.hpp"
+#include "rti/reflection/diffuse.hpp"
+#include "rti/trace/tracer.hpp"
+#include "rti/util/logger.hpp"
+#include "rti/util/synthetic_point_cloud.hpp"
+
+// End-to-end benchmarks of the tracer on synthetic geometries.
+//
+// Arguments: number of discs, number of threads, sticking coefficient in
+// percent, and the options of the tracer as bit flags (see tracer_options).
+// Example: ./benchmark --benchmark_filter='tracer/trench/100000/.*'
+
+using namespace rti;
+using nt = float;
+using cloud_t = bench::synthetic_point_cloud<nt>;
+using generator_t = cloud_t (*) (size_t);
+
+static auto numrays = 1024 * 1024ull;
+
+enum tracer_options : int {
+  DEFAULT = 0,
+  ANALYTIC_BOUNDARY = 1 << 0,
+  BACK_FACE_FILTER = 1 << 1,
+  MULTI_HIT_FILTER = 1 << 2
+};
+
+class bm_particle : public particle::i_particle<nt> {
+public:
+  nt get_sticking_probability(RTCRay& pRayIn, RTCHit& pHitIn, geo::meta_geometry<nt>& pGeometry,
+                              rng::i_rng& pRng, rng::i_rng::i_state& pRngState) override final
+  {
+    return sSticking;
+  }
+  void init_new() override final {}
+  inline static nt sSticking = 1;
+};
+
+static cloud_t make_trench(size_t pNumDiscs) { return cloud_t::trench(pNumDiscs); }
+static cloud_t make_hole(size_t pNumDiscs) { return cloud_t::hole(pNumDiscs); }
+static cloud_t make_cylinder(size_t pNumDiscs) { return cloud_t::cylinder(pNumDiscs); }
+// A shallow, wide trench; many rays leave the domain at grazing angles
+static cloud_t make_wide_trench(size_t pNumDiscs) { return cloud_t::trench(pNumDiscs, 10, 8, 1); }
+
+// Generating large clouds takes a while; reuse them between the benchmark cases.
+static
+cloud_t& get_cloud(generator_t pGenerator, size_t pNumDiscs)
+{
+  static auto cache = std::map<std::pair<generator_t, size_t>, cloud_t> {};
+  auto key = std::make_pair(pGenerator, pNumDiscs);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    cache.clear(); // keep at most one (possibly large) cloud in memory
+    it = cache.emplace(key, pGenerator(pNumDiscs)).first;
+  }
+  return it->second;
+}
+
+static
+void tracer(benchmark::State& pState, generator_t pGenerator)
+{
+  auto numdiscs = (size_t) pState.range(0);
+  auto numthreads = (int) pState.range(1);
+  bm_particle::sSticking = (nt) pState.range(2) / 100;
+  auto options = (int) pState.range(3);
+
+  auto maxthreads = omp_get_max_threads();
+  omp_set_num_threads(numthreads);
+  #pragma omp parallel
+  {
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+  }
+  auto loglevels = util::logger::get_levels();
+  util::logger::set_levels(util::log_level::NONE);
+
+  auto& cloud = get_cloud(pGenerator, numdiscs);
+  auto device = rtcNewDevice("hugepages=1");
+  auto geometry = geo::point_cloud_disc_geometry<nt> {device, cloud.points, cloud.normals};
+  if ( ! (options & MULTI_HIT_FILTER)) {
+    // Outside of the timed loop; see the counter neighborhood-ms
+    geometry.build_neighborhood();
+  }
+  auto bdbox = geometry.get_bounding_box();
+  auto boundary = geo::boundary_x_y<nt>
+    {device, bdbox, geo::bound_condition::PERIODIC, geo::bound_condition::PERIODIC};
+  auto zmax = std::max(bdbox[0][2], bdbox[1][2]);
+  auto origin = ray::rectangle_origin_z<nt>
+    {zmax, {bdbox[0][0], bdbox[0][1]}, {bdbox[1][0], bdbox[1][1]}};
+  auto direction = ray::cosine_direction_z<nt> {};
+  auto source = ray::source<nt> {origin, direction};
+  auto tracer = trace::tracer<nt, bm_particle, reflection::diffuse<nt> >
+    {geometry, boundary, source, numrays};
+  tracer.set_analytic_boundary(options & ANALYTIC_BOUNDARY);
+  tracer.set_back_face_filter(options & BACK_FACE_FILTER);
+  using tracer_t = decltype(tracer);
+  tracer.set_multi_hit_engine(options & MULTI_HIT_FILTER
+                              ? tracer_t::multi_hit_engine::FILTER
+                              : tracer_t::multi_hit_engine::NEIGHBORHOOD);
+
+  auto rays = 0.0;
+  auto hits = 0.0;
+  auto bounces = 0.0;
+  for (auto _ : pState) {
+    auto result = tracer.run();
+    rays += result.numRays;
+    hits += result.hitc;
+    bounces += result.reflectc;
+    benchmark::DoNotOptimize(result.hitAccumulator);
+  }
+  pState.counters["discs"] = (double) geometry.get_num_primitives();
+  for (auto const& tt : geometry.get_timing().get_children()) {
+    if (tt.get_name() == "neighborhood") {
+      pState.counters["neighborhood-ms"] = tt.get_nanoseconds() * 1e-6;
+    }
+  }
+  pState.counters["rays/s"] = benchmark::Counter(rays, benchmark::Counter::kIsRate);
+  pState.counters["hits/s"] = benchmark::Counter(hits, benchmark::Counter::kIsRate);
+  pState.counters["bounces/s"] = benchmark::Counter(bounces, benchmark::Counter::kIsRate);
+
+  util::logger::set_levels(loglevels);
+  omp_set_num_threads(maxthreads);
+  rtcReleaseDevice(device);
+}
+
+static
+void tracer_arguments(benchmark::internal::Benchmark* pBenchmark)
+{
+  auto threads = std::vector<int> {};
+  for (auto tt = 1; tt < omp_get_max_threads(); tt *= 2) {
+    threads.push_back(tt);
+  }
+  threads.push_back(omp_get_max_threads());
+  for (auto numdiscs : {10 * 1000, 100 * 1000, 1000 * 1000, 10 * 1000 * 1000}) {
+    for (auto numthreads : threads) {
+      for (auto sticking : {10, 50, 100}) {
+        pBenchmark->Args({numdiscs, numthreads, sticking, DEFAULT});
+      }
+    }
+  }
+}
+
+// Compares the options of the tracer on all threads with low sticking (many bounces)
+static
+void options_arguments(benchmark::internal::Benchmark* pBenchmark)
+{
+  for (auto numdiscs : {100 * 1000, 1000 * 1000}) {
+    for (auto options : {DEFAULT, ANALYTIC_BOUNDARY, BACK_FACE_FILTER, MULTI_HIT_FILTER}) {
+      pBenchmark->Args({numdiscs, omp_get_max_threads(), 10, options});
+    }
+  }
+}
+
+// Compares the multi-hit engines. The FILTER engine does not need the
+// neighborhood; its construction time is reported in the counter
+// neighborhood-ms of the NEIGHBORHOOD engine.
+static
+void multi_hit_arguments(benchmark::internal::Benchmark* pBenchmark)
+{
+  for (auto numdiscs : {100 * 1000, 1000 * 1000, 10 * 1000 * 1000}) {
+    for (auto sticking : {10, 100}) {
+      for (auto options : {DEFAULT, MULTI_HIT_FILTER}) {
+        pBenchmark->Args({numdiscs, omp_get_max_threads(), sticking, options});
+      }
+    }
+  }
+}
+
+BENCHMARK_CAPTURE(tracer, trench, make_trench)
+->Apply(tracer_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(tracer, hole, make_hole)
+->Apply(tracer_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(tracer, cylinder, make_cylinder)
+->Apply(tracer_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(tracer, wide_trench, make_wide_trench)
+->Apply(options_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(tracer, trench_multi_hit, make_trench)
+->Apply(multi_hit_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(tracer, hole_multi_hit, make_hole)
+->Apply(multi_hit_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(tracer, cylinder_multi_hit, make_cylinder)
+->Apply(multi_hit_arguments)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "rti/util/utils.hpp"
+
+// Generates point clouds (discs with normals) of typical structures in memory,
+// such that benchmarks do not depend on input files.
+//
+// All structures live in the domain [0, width] x [0, width] in the x-y-plane.
+// The top surface is the plane z == 0 and the structure extends to z == -depth.
+// The surfaces are sampled on a regular grid with a spacing chosen such that
+// the cloud contains approximately the requested number of discs. The radius
+// of the discs is equal to the grid spacing (as in rti::device).
+
+namespace rti { namespace bench {
+
+  template<typename numeric_type>
+  class synthetic_point_cloud {
+  public:
+    std::vector<util::quadruple<numeric_type> > points;
+    std::vector<util::triple<numeric_type> > normals;
+
+    size_t size() const
+    {
+      return points.size();
+    }
+
+    // A trench along the y-axis in the middle of the domain
+    static
+    synthetic_point_cloud trench(size_t pNumDiscs, numeric_type pWidth = 10,
+                                 numeric_type pTrenchWidth = 2, numeric_type pDepth = 8)
+    {
+      auto area = pWidth * pWidth + 2 * pDepth * pWidth;
+      auto hh = spacing(area, pNumDiscs);
+      auto xl = (pWidth - pTrenchWidth) / 2;
+      auto xr = (pWidth + pTrenchWidth) / 2;
+      auto result = synthetic_point_cloud {};
+      result.reserve(pNumDiscs);
+      // top and bottom
+      result.add_plane(pWidth, 0, hh, [=](auto xx, auto yy) { return xx < xl || xx > xr; });
+      result.add_plane(pWidth, -pDepth, hh, [=](auto xx, auto yy) { return xl <= xx && xx <= xr; });
+      // the walls; the normals point into the trench
+      for (auto yy = hh / 2; yy < pWidth; yy += hh) {
+        for (auto zz = -hh / 2; zz > -pDepth; zz -= hh) {
+          result.add({xl, yy, zz, hh}, {1, 0, 0});
+          result.add({xr, yy, zz, hh}, {-1, 0, 0});
+        }
+      }
+      return result;
+    }
+
+    // A cylindrical hole in the middle of the domain
+    static
+    synthetic_point_cloud hole(size_t pNumDiscs, numeric_type pWidth = 10,
+                               numeric_type pRadius = 1, numeric_type pDepth = 8)
+    {
+      auto area = pWidth * pWidth + 2 * M_PI * pRadius * pDepth;
+      auto hh = spacing(area, pNumDiscs);
+      auto cc = pWidth / 2;
+      auto result = synthetic_point_cloud {};
+      result.reserve(pNumDiscs);
+      auto inside = [=](auto xx, auto yy) { return (xx - cc) * (xx - cc) + (yy - cc) * (yy - cc) <= pRadius * pRadius; };
+      result.add_plane(pWidth, 0, hh, [=](auto xx, auto yy) { return ! inside(xx, yy); });
+      result.add_plane(pWidth, -pDepth, hh, inside);
+      // the normals of the wall point towards the axis of the hole
+      result.add_cylinder_wall(cc, pRadius, -pDepth, 0, hh, -1);
+      return result;
+    }
+
+    // A cylindrical pillar of height pDepth in the middle of the domain
+    static
+    synthetic_point_cloud cylinder(size_t pNumDiscs, numeric_type pWidth = 10,
+                                   numeric_type pRadius = 1, numeric_type pDepth = 8)
+    {
+      auto area = pWidth * pWidth + 2 * M_PI * pRadius * pDepth;
+      auto hh = spacing(area, pNumDiscs);
+      auto cc = pWidth / 2;
+      auto result = synthetic_point_cloud {};
+      result.reserve(pNumDiscs);
+      auto inside = [=](auto xx, auto yy) { return (xx - cc) * (xx - cc) + (yy - cc) * (yy - cc) <= pRadius * pRadius; };
+      result.add_plane(pWidth, 0, hh, inside);
+      result.add_plane(pWidth, -pDepth, hh, [=](auto xx, auto yy) { return ! inside(xx, yy); });
+      // the normals of the wall point away from the axis of the pillar
+      result.add_cylinder_wall(cc, pRadius, -pDepth, 0, hh, 1);
+      return result;
+    }
+
+  private:
+    static
+    numeric_type spacing(double pArea, size_t pNumDiscs)
+    {
+      return (numeric_type) std::sqrt(pArea / std::max<size_t>(pNumDiscs, 1));
+    }
+
+    void reserve(size_t pNum)
+    {
+      points.reserve(pNum);
+      normals.reserve(pNum);
+    }
+
+    void add(util::quadruple<numeric_type> pPoint, util::triple<numeric_type> pNormal)
+    {
+      points.push_back(pPoint);
+      normals.push_back(pNormal);
+    }
+
+    // Adds a horizontal plane at height pZ (normal in positive z-direction)
+    // restricted to the grid points for which pPredicate(x, y) holds.
+    template<typename predicate_type>
+    void add_plane(numeric_type pWidth, numeric_type pZ, numeric_type pSpacing, predicate_type pPredicate)
+    {
+      for (auto xx = pSpacing / 2; xx < pWidth; xx += pSpacing) {
+        for (auto yy = pSpacing / 2; yy < pWidth; yy += pSpacing) {
+          if (pPredicate(xx, yy)) {
+            add({xx, yy, pZ, pSpacing}, {0, 0, 1});
+          }
+        }
+      }
+    }
+
+    // Adds a vertical cylinder wall with axis (pCenter, pCenter, z). The sign
+    // pOrientation selects normals pointing away from (+1) or towards (-1) the axis.
+    void add_cylinder_wall(numeric_type pCenter, numeric_type pRadius,
+                           numeric_type pZMin, numeric_type pZMax, numeric_type pSpacing,
+                           numeric_type pOrientation)
+    {
+      auto numangles = std::max<size_t>(3, (size_t) std::ceil(2 * M_PI * pRadius / pSpacing));
+      for (size_t aidx = 0; aidx < numangles; ++aidx) {
+        auto angle = 2 * M_PI * aidx / numangles;
+        auto nx = (numeric_type) std::cos(angle);
+        auto ny = (numeric_type) std::sin(angle);
+        for (auto zz = pZMax - pSpacing / 2; zz > pZMin; zz -= pSpacing) {
+          add({pCenter + pRadius * nx, pCenter + pRadius * ny, zz, pSpacing},
+              {pOrientation * nx, pOrientation * ny, 0});
+        }
+      }
+    }
+  };
+}} // namespace
@@ -17,6 +17,10 @@ stickingcoefficient = 0.2
 numofrays = 8e7
 numofthreads = 1
 cmd = "../build/rti_m --infile {} --outfile {} --sticking-coefficient {} --triangles --number-of-rays {} --max-threads {}" # format string
+# Run all the jobs in one process of rti-batch instead of one process per run
+usebatch = False
+batchmanifest = "./output/manifest.txt"
+batchcmd = "../build/rti-batch --manifest {} --sticking-coefficient {} --number-of-rays {} --max-threads {}" # format string
 
 # Prepare
 infiles = glob(inpath + '**/*', recursive=True)
@@ -26,7 +30,7 @@ infiles = map(lambda ss: [ss, os.path.dirname(ss), os.path.basename(ss)], infile
 # Define functions
 def run_processes():
   # Compile
-  subprocess.run(["(cd ../build; cmake --build . --target rti)"], shell=True)
+  subprocess.run(["(cd ../build; cmake --build . --target rti rti-batch)"], shell=True)
   #
   def handle(triple):
     global cmd
@@ -37,21 +41,39 @@ def run_processes():
     extbasename = "result--" + basename
     #print(f'intermediatePath == {intermediatePath}')
     listoutpaths = []
+    if usebatch:
+      # One job with repetitions; rti-batch writes <out>.<i>.vtp
+      batchoutname = os.path.join("./output", intermediatePath, basename + '.d', extbasename)
+      os.makedirs(os.path.dirname(batchoutname), exist_ok=True)
+      manifestlines.append(f'{inname} {batchoutname} repetitions={numruns}\n')
     for runnumber in range(numruns):
       outpath = os.path.join("./output", intermediatePath, basename + '.d', str(runnumber))
       os.makedirs(outpath, exist_ok=True)
       outname = os.path.join(outpath, extbasename);
-      concretecmd = cmd.format(inname, outname, stickingcoefficient, numofrays, numofthreads)
-      #print(f'cmd == {cmd}')
-      # run command. We do not save standard output.
-      subprocess.run(concretecmd, shell=True)
+      if usebatch:
+        batchoutfile = batchoutname + (f'.{runnumber}' if numruns > 1 else '') + '.vtp'
+        batchmoves.append([batchoutfile, outname + '.vtp'])
+      else:
+        concretecmd = cmd.format(inname, outname, stickingcoefficient, numofrays, numofthreads)
+        #print(f'cmd == {cmd}')
+        # run command. We do not save standard output.
+        subprocess.run(concretecmd, shell=True)
       # Collect outpaths
       listoutpaths.append(outname)
     return listoutpaths
+  manifestlines = []
+  batchmoves = []
   result = []
   for triple in infiles:
     tt = handle(triple)
     result.extend(tt)
+  if usebatch:
+    with open(batchmanifest, 'w') as fp:
+      fp.writelines(manifestlines)
+    subprocess.run(batchcmd.format(batchmanifest, stickingcoefficient, int(numofrays), numofthreads), shell=True)
+    # Move the outputs into the run directories the way the single runs write them
+    for batchoutfile, outfile in batchmoves:
+      os.replace(batchoutfile, outfile)
   ## Note: the results is a list of out-file-paths without the '.vtp' suffix
   return result
 
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <functional>
+#include <future>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include <omp.h>
 #include <xmmintrin.h>
 #include <pmmintrin.h>
 
@@ -11,6 +16,7 @@
 
 
 #include "geo/boundary_x_y.hpp"
+#include "io/point_cloud_buffers.hpp"
 #include "geo/bound_condition.hpp"
 #include "io/vtp_writer.hpp"
 #include "particle/i_particle.hpp"
@@ -24,6 +30,9 @@
 #include "reflection/diffuse.hpp"
 #include "trace/point_cloud_context.hpp"
 #include "trace/tracer.hpp"
+#include "util/array_view.hpp"
+#include "util/cancellation_token.hpp"
+#include "util/timing.hpp"
 #include "util/utils.hpp"
 
 namespace rti {
@@ -44,86 +53,466 @@ namespace rti {
       init_memory_flags();
     }
 
-    void set_points(std::vector<std::array<numeric_type, 3> > points_)
+    // The setters for the points, the normals and the grid spacing come in
+    // three variants: copying a vector (reusing the memory of the previous
+    // call), moving a vector, and referencing caller owned memory without
+    // copying. In the latter case the element idx is read from
+    // data_[idx * stride_ + dim] and the memory has to stay valid until run()
+    // returns.
+
+    void set_points(std::vector<std::array<numeric_type, 3> > const& points_)
     {
       points = points_;
+      pointsview = {reinterpret_cast<numeric_type const*>(points.data()), points.size(), 3};
+      inputversion += 1;
+    }
+
+    void set_points(std::vector<std::array<numeric_type, 3> >&& points_)
+    {
+      points = std::move(points_);
+      pointsview = {reinterpret_cast<numeric_type const*>(points.data()), points.size(), 3};
+      inputversion += 1;
     }
 
-    void set_normals(std::vector<std::array<numeric_type, 3> > normals_)
+    void set_points(numeric_type const* data_, size_t size_, size_t stride_ = 3)
+    {
+      pointsview = {data_, size_, stride_};
+      inputversion += 1;
+    }
+
+    void set_normals(std::vector<std::array<numeric_type, 3> > const& normals_)
     {
       normals = normals_;
+      normalsview = {reinterpret_cast<numeric_type const*>(normals.data()), normals.size(), 3};
+      inputversion += 1;
+    }
+
+    void set_normals(std::vector<std::array<numeric_type, 3> >&& normals_)
+    {
+      normals = std::move(normals_);
+      normalsview = {reinterpret_cast<numeric_type const*>(normals.data()), normals.size(), 3};
+      inputversion += 1;
+    }
+
+    void set_normals(numeric_type const* data_, size_t size_, size_t stride_ = 3)
+    {
+      normalsview = {data_, size_, stride_};
+      inputversion += 1;
     }
 
-    void set_grid_spacing(std::vector<numeric_type> spacing_)
+    void set_grid_spacing(std::vector<numeric_type> const& spacing_)
     {
       spacing = spacing_;
+      spacingview = {spacing.data(), spacing.size(), 1};
+      inputversion += 1;
+    }
+
+    void set_grid_spacing(std::vector<numeric_type>&& spacing_)
+    {
+      spacing = std::move(spacing_);
+      spacingview = {spacing.data(), spacing.size(), 1};
+      inputversion += 1;
+    }
+
+    void set_grid_spacing(numeric_type const* data_, size_t size_, size_t stride_ = 1)
+    {
+      spacingview = {data_, size_, stride_};
+      inputversion += 1;
     }
 
     void set_grid_spacing(numeric_type spacing_) {
-      spacing.clear();
-      spacing.push_back(spacing_);
+      spacing.assign(1, spacing_);
+      spacingview = {spacing.data(), spacing.size(), 1};
+      inputversion += 1;
     }
 
     void set_number_of_rays(size_t numofrays_)
     {
-      numofrays = numofrays_;
+      if (numofrays_ != numofrays) {
+        numofrays = numofrays_;
+        inputversion += 1;
+      }
+    }
+
+    // Limits the duration of the trace of run() to about seconds_ (0: no
+    // limit); see get_number_of_rays_traced()
+    void set_time_budget(double seconds_)
+    {
+      timebudget = seconds_;
+    }
+
+    // The number of rays of the last call to run(); less than the number of
+    // rays set if the time budget was exhausted
+    size_t get_number_of_rays_traced() const
+    {
+      return numofraystraced;
     }
 
     void set_x(bound_condition cond)
     {
-      xCond = cond;
+      if (cond != xCond) {
+        xCond = cond;
+        inputversion += 1;
+      }
     }
 
     void set_y(bound_condition cond)
     {
-      yCond = cond;
+      if (cond != yCond) {
+        yCond = cond;
+        inputversion += 1;
+      }
     }
 
     void set(ray::i_direction<numeric_type>& srcDirection)
     {
       direction = srcDirection;
+      inputversion += 1;
+    }
+
+    // Keeps the scene of a run (the Embree buffers, the neighborhood, the
+    // exposed areas and the BVH) for the next run if none of the setters is
+    // called in between (setters of scalars only if the value changes), e.g.,
+    // for a sweep over the sticking coefficient on one surface. Changes to
+    // caller owned memory passed to the setters without copying are not
+    // detected; call the setter again after such a change.
+    void set_keep_scene(bool keep_)
+    {
+      keepscene = keep_;
     }
 
     void run()
     {
-      auto device_config = "hugepages=1";
-      auto device = rtcNewDevice(device_config);
-      auto pointsandradii = combine_points_with_grid_spacing_and_compute_max_disc_radius();
-      auto geometry = geo::point_cloud_disc_geometry<numeric_type>{device, pointsandradii, normals};
-      auto bdbox = geometry.get_bounding_box();
-      auto bdboxEps = maxDscRad;
-      bdbox = increase_size_of_bounding_box_by_eps_on_z_axis(bdbox, bdboxEps);
-      //bdbox = increase_size_of_bounding_box_on_x_and_y_axes(bdbox, 8);
-      auto origin = create_rectangular_source_from_bounding_box(bdbox);
-      auto boundary = geo::boundary_x_y<numeric_type> {device, bdbox, xCond, yCond};
-      auto source = ray::source<numeric_type> {origin, direction};
-      auto tracer = trace::tracer<numeric_type, particle_type, reflection_type>
-        {geometry, boundary, source, numofrays};
-      auto traceresult = tracer.run();
-      mcestimates = extract_mc_estimates_normalized_smoothed(traceresult, geometry);
-      hitcnts = extract_hit_cnts(traceresult);
-      assert(mcestimates.size() == hitcnts.size() && "Correctness Assumption");
-      rtcReleaseDevice(device);
-      // { // Debug
-      //   auto path = "/home/alexanders/vtk/outputs/bounding-box.vtp";
-      //   std::cout << "Writing bounding box to " << path << std::endl;
-      //   io::vtp_writer<numeric_type>::write(boundary, path);
-      // }
+      auto sc = run_with(take_next_scene(false).get(), keepscene, timebudget, {}, 0, {});
+      if (sc != nullptr) {
+        recycle_scene(std::move(sc));
+      }
+    }
+
+    // Prepares the scene of the current points, normals, grid spacing and
+    // settings in the background on at most threads_ threads (0: a quarter
+    // of the threads): the Embree buffers, the neighborhood, the exposed
+    // areas and the BVH. The next run() or run_async() traces the prepared
+    // scene; hence, the setup of the geometry of step k + 1 is hidden behind
+    // the trace of step k (see run_async()). The setters may be called again
+    // right away; memory passed to them without copying has to stay valid
+    // until that run() returns.
+    void prepare_next(size_t threads_ = 0)
+    {
+      if (threads_ == 0) {
+        threads_ = std::max(omp_get_max_threads() / 4, 1);
+      }
+      auto sc = take_spare_scene();
+      capture_scene_input(sc->input, true);
+      nextscene = std::async(std::launch::async, [this, threads_, sc = std::move(sc)] () mutable {
+          // Embree builds on the joining threads and on threads_ threads of its own
+          auto config = "hugepages=1,threads=" + std::to_string(threads_);
+          return prepare_scene(std::move(sc), (int) threads_, config);
+        });
+    }
+
+    // The results of run_async(); the same as the ones of the getters after
+    // run()
+    struct run_result {
+      std::vector<numeric_type> mcestimates;
+      std::vector<size_t> hitcnts;
+      size_t numofrays = 0;
+      bool cancelled = false;
+      util::timing_record timing;
+    };
+
+    using progress_callback = std::function<void (trace::progress_report const&)>;
+
+    // Runs run() on another thread; the caller may, e.g., advect the surface
+    // or write files in the meantime. progress_ (if set) is called on a
+    // tracing thread about every progressseconds_ seconds. Cancelling token_
+    // stops the trace early; the result then contains the rays traced so
+    // far. The input is taken when run_async() is called; the setters and
+    // prepare_next() may be called while the trace runs, the getters not
+    // until the future is ready.
+    std::future<run_result> run_async(progress_callback progress_ = {},
+                                      double progressseconds_ = 1,
+                                      util::cancellation_token token_ = {})
+    {
+      auto scene = take_next_scene(true);
+      // The setters may be called while the trace runs
+      auto keepscene_ = keepscene;
+      auto timebudget_ = timebudget;
+      return std::async(std::launch::async,
+                        [this, scene = std::move(scene), keepscene_, timebudget_,
+                         progress_, progressseconds_, token_] () mutable {
+          // The OpenMP threads of another thread are not the ones of the
+          // constructor
+          init_memory_flags();
+          // A scene which is not kept is released on this thread; the spare
+          // scene belongs to the caller (see run())
+          run_with(scene.get(), keepscene_, timebudget_, progress_, progressseconds_, token_);
+          return run_result {mcestimates, hitcnts, numofraystraced, cancelled, timing};
+        });
     }
 
+    // Returns a copy; see also get_mc_estimates_view() and copy_mc_estimates_to()
     std::vector<numeric_type> get_mc_estimates()
     {
       return mcestimates;
     }
 
+    // Returns a copy; see also get_hit_cnts_view() and copy_hit_cnts_to()
     std::vector<size_t> get_hit_cnts()
     {
       return hitcnts;
     }
 
+    // The views are valid until the next call to run() or the destruction of
+    // the device.
+    util::array_view<numeric_type const> get_mc_estimates_view() const
+    {
+      return mcestimates;
+    }
+
+    util::array_view<size_t const> get_hit_cnts_view() const
+    {
+      return hitcnts;
+    }
+
+    // Writes one value per point into caller owned memory
+    void copy_mc_estimates_to(numeric_type* out_) const
+    {
+      std::copy(mcestimates.begin(), mcestimates.end(), out_);
+    }
+
+    void copy_hit_cnts_to(size_t* out_) const
+    {
+      std::copy(hitcnts.begin(), hitcnts.end(), out_);
+    }
+
+    // Durations of the phases of the last call to run()
+    util::timing_record const& get_timing()
+    {
+      return timing;
+    }
+
+    // A non-owning view of size elements with stride values between the
+    // first values of consecutive elements
+    struct strided_view {
+      numeric_type const* data = nullptr;
+      size_t size = 0;
+      size_t stride = 0;
+
+      numeric_type const* operator[](size_t idx) const
+      {
+        return data + idx * stride;
+      }
+    };
+
   private:
     //// Auxiliary functions
 
+    // The input of a scene. A snapshot (see capture_scene_input()) holds
+    // copies of the vectors of the device, and its views refer to the copies.
+    struct scene_input {
+      std::vector<util::triple<numeric_type> > points;
+      std::vector<util::triple<numeric_type> > normals;
+      std::vector<numeric_type> spacing;
+      strided_view pointsview;
+      strided_view normalsview;
+      strided_view spacingview;
+      size_t numofrays = 0;
+      bound_condition xCond = geo::bound_condition::REFLECTIVE;
+      bound_condition yCond = geo::bound_condition::REFLECTIVE;
+      // The input version of the device when the input was captured
+      size_t version = 0;
+    };
+
+    using tracer_type = trace::tracer<numeric_type, particle_type, reflection_type>;
+
+    // Everything run() traces. The members refer to each other; hence, a
+    // scene is not moved. After a run, a scene which is not kept is cleared
+    // and prepared again for the next run (see recycle_scene()); it keeps the
+    // memory of its input and its buffers and its Embree device.
+    struct scene {
+      scene_input input;
+      RTCDevice rtcdevice = nullptr;
+      // The configuration of rtcdevice
+      std::string rtcconfig;
+      io::point_cloud_buffers buffers;
+      numeric_type maxDscRad = 0.0;
+      std::unique_ptr<geo::point_cloud_disc_geometry<numeric_type> > geometry;
+      std::unique_ptr<geo::boundary_x_y<numeric_type> > boundary;
+      std::unique_ptr<ray::rectangle_origin_z<numeric_type> > origin;
+      std::unique_ptr<ray::source<numeric_type> > source;
+      std::unique_ptr<tracer_type> tracer;
+      util::timing_record timing {"prepare"};
+
+      // Releases everything but the input, the buffers and the device
+      void clear()
+      {
+        tracer.reset();
+        source.reset();
+        origin.reset();
+        boundary.reset();
+        geometry.reset();
+      }
+
+      ~scene()
+      {
+        clear();
+        if (rtcdevice != nullptr) {
+          rtcReleaseDevice(rtcdevice);
+        }
+      }
+    };
+
+    template<typename Ty>
+    static
+    strided_view rebase(strided_view view_, std::vector<Ty> const& from_, std::vector<Ty> const& to_)
+    {
+      if ( ! from_.empty() && view_.data == reinterpret_cast<numeric_type const*>(from_.data())) {
+        view_.data = reinterpret_cast<numeric_type const*>(to_.data());
+      }
+      return view_;
+    }
+
+    // Takes the current input. A snapshot (snapshot_) copies the vectors of
+    // the device which the views refer to (reusing the memory of input_) such
+    // that the setters may be called while the scene is prepared on another
+    // thread; otherwise, the views refer to the input of the device.
+    void capture_scene_input(scene_input& input_, bool snapshot_)
+    {
+      if (snapshot_) {
+        if (pointsview.data == reinterpret_cast<numeric_type const*>(points.data())) input_.points = points;
+        if (normalsview.data == reinterpret_cast<numeric_type const*>(normals.data())) input_.normals = normals;
+        if (spacingview.data == spacing.data()) input_.spacing = spacing;
+        input_.pointsview = rebase(pointsview, points, input_.points);
+        input_.normalsview = rebase(normalsview, normals, input_.normals);
+        input_.spacingview = rebase(spacingview, spacing, input_.spacing);
+      } else {
+        input_.pointsview = pointsview;
+        input_.normalsview = normalsview;
+        input_.spacingview = spacingview;
+      }
+      input_.numofrays = numofrays;
+      input_.xCond = xCond;
+      input_.yCond = yCond;
+      input_.version = inputversion;
+    }
+
+    // The scene of the last run() which has not been kept, if any
+    std::unique_ptr<scene> take_spare_scene()
+    {
+      if (sparescene != nullptr) {
+        return std::move(sparescene);
+      }
+      return std::make_unique<scene>();
+    }
+
+    void recycle_scene(std::unique_ptr<scene> scene_)
+    {
+      scene_->clear();
+      sparescene = std::move(scene_);
+    }
+
+    // The scene prepared by prepare_next(), the kept scene of the last run
+    // (see set_keep_scene()) or, otherwise, one which is prepared from the
+    // current input on all threads when it is waited for. snapshot_ is set if
+    // it may be waited for on another thread (see capture_scene_input()).
+    std::future<std::unique_ptr<scene> > take_next_scene(bool snapshot_)
+    {
+      if (nextscene.valid()) {
+        return std::move(nextscene);
+      }
+      if (keepscene && lastscene != nullptr && lastscene->input.version == inputversion) {
+        return std::async(std::launch::deferred, [sc = std::move(lastscene)] () mutable {
+            return std::move(sc);
+          });
+      }
+      auto sc = take_spare_scene();
+      capture_scene_input(sc->input, snapshot_);
+      return std::async(std::launch::deferred, [this, sc = std::move(sc)] () mutable {
+          return prepare_scene(std::move(sc), omp_get_max_threads(), "hugepages=1");
+        });
+    }
+
+    // Prepares the empty (or cleared) scene sc_ from its input
+    std::unique_ptr<scene>
+    prepare_scene(std::unique_ptr<scene> sc_, int numthreads_, std::string const& config_)
+    {
+      auto sc = std::move(sc_);
+      sc->timing = util::timing_record {"prepare"};
+      auto prepareprobe = util::timing_probe {sc->timing};
+      if (sc->rtcdevice != nullptr && sc->rtcconfig != config_) {
+        rtcReleaseDevice(sc->rtcdevice);
+        sc->rtcdevice = nullptr;
+      }
+      if (sc->rtcdevice == nullptr) {
+        sc->rtcdevice = rtcNewDevice(config_.c_str());
+        sc->rtcconfig = config_;
+      }
+      fill_buffers_and_compute_max_disc_radius(*sc);
+      // Embree shares the buffers
+      sc->geometry = std::make_unique<geo::point_cloud_disc_geometry<numeric_type> >(sc->rtcdevice, sc->buffers);
+      // The smoothing of the results uses the neighborhood
+      sc->geometry->build_neighborhood();
+      auto bdbox = sc->geometry->get_bounding_box();
+      auto bdboxEps = sc->maxDscRad;
+      bdbox = increase_size_of_bounding_box_by_eps_on_z_axis(bdbox, bdboxEps);
+      //bdbox = increase_size_of_bounding_box_on_x_and_y_axes(bdbox, 8);
+      sc->origin = std::make_unique<ray::rectangle_origin_z<numeric_type> >
+        (create_rectangular_source_from_bounding_box(bdbox));
+      sc->boundary = std::make_unique<geo::boundary_x_y<numeric_type> >
+        (sc->rtcdevice, bdbox, sc->input.xCond, sc->input.yCond);
+      sc->source = std::make_unique<ray::source<numeric_type> >(*sc->origin, direction);
+      sc->tracer = std::make_unique<tracer_type>(*sc->geometry, *sc->boundary, *sc->source, sc->input.numofrays);
+      // The BVH and the exposed areas
+      sc->tracer->prepare(numthreads_);
+      sc->timing.merge(sc->geometry->get_timing());
+      return sc;
+    }
+
+    // Traces the scene with the options of run_async(). The settings are
+    // passed since the setters may be called meanwhile. Returns the scene
+    // unless it is kept.
+    std::unique_ptr<scene> run_with(std::unique_ptr<scene> scene_,
+                                    bool keepscene_,
+                                    double timebudget_,
+                                    progress_callback progress_,
+                                    double progressseconds_,
+                                    util::cancellation_token token_)
+    {
+      timing = util::timing_record {};
+      auto runprobe = util::timing_probe {timing};
+      timing.merge(scene_->timing);
+      // A kept scene is not prepared again
+      scene_->timing = util::timing_record {"prepare"};
+      auto& tracer = *scene_->tracer;
+      tracer.set_keep_scene(keepscene_);
+      tracer.set_time_budget(timebudget_);
+      tracer.set_cancellation_token(token_);
+      // Set even when empty: the tracer of a kept scene outlives this run,
+      // and a callback of an earlier run may refer to freed state.
+      tracer.set_progress_callback(progress_, progressseconds_);
+      auto traceresult = tracer.run();
+      numofraystraced = traceresult.numRays;
+      cancelled = traceresult.cancelled;
+      timing.merge(traceresult.timing);
+      auto postprobe = util::timing_probe {timing.child("post-processing")};
+      extract_mc_estimates_normalized_smoothed(traceresult, *scene_->geometry);
+      extract_hit_cnts(traceresult);
+      assert(mcestimates.size() == hitcnts.size() && "Correctness Assumption");
+      postprobe.stop();
+      if (keepscene_) {
+        lastscene = std::move(scene_);
+      } else {
+        lastscene.reset();
+      }
+      // { // Debug
+      //   auto path = "/home/alexanders/vtk/outputs/bounding-box.vtp";
+      //   std::cout << "Writing bounding box to " << path << std::endl;
+      //   io::vtp_writer<numeric_type>::write(boundary, path);
+      // }
+      return scene_;
+    }
+
     void normalize_mc_estimates()
     {
       // std::cout << "[Alex] normalizing_mc_estimates()" << std::endl;
@@ -149,23 +538,27 @@ namespace rti {
       }
     }
 
-    std::vector<size_t>
-    extract_hit_cnts(trace::result<numeric_type>& traceresult)
+    // Fills hitcnts (reusing its memory)
+    void extract_hit_cnts(trace::result<numeric_type>& traceresult)
     {
-      return traceresult.hitAccumulator->get_cnts();
+      auto const& cnts = traceresult.hitAccumulator->get_cnts_ref();
+      hitcnts.resize(cnts.size());
+      for (size_t idx = 0; idx < cnts.size(); ++idx) {
+        hitcnts[idx] = cnts[idx];
+      }
     }
     
-    std::vector<numeric_type>
+    // Fills mcestimates (reusing its memory)
+    void
     extract_mc_estimates_normalized_smoothed
       (trace::result<numeric_type>& traceresult,
        geo::point_cloud_disc_geometry<numeric_type>& geometry)
     {
       auto& hitacc = traceresult.hitAccumulator;
-      auto values = hitacc->get_values();
-      auto areas = hitacc->get_exposed_areas();
+      auto const& values = hitacc->get_values_ref();
+      auto const& areas = hitacc->get_exposed_areas_ref();
 
-      auto mcestimates = std::vector<numeric_type> {};
-      mcestimates.reserve(values.size());
+      mcestimates.resize(values.size());
       
       auto maxv = 0.0;
       assert (values.size() == areas.size() && "Correctness Assertion");
@@ -173,13 +566,13 @@ namespace rti {
       for (size_t idx = 0; idx < values.size(); ++idx) {
         auto vv = values[idx] / areas[idx];
         { // Average over the neighborhood
-          auto neighborhood = geometry.get_neighbors(idx);
+          auto const& neighborhood = geometry.get_neighbors(idx);
           for (auto const& nbi : neighborhood) {
             vv += values[nbi] / areas[nbi];
           }
           vv /= (neighborhood.size() + 1);
         }
-        mcestimates.push_back(vv);
+        mcestimates[idx] = vv;
         if (maxv < vv) {
           maxv = vv;
         }
@@ -188,7 +581,6 @@ namespace rti {
       for (auto& vv : mcestimates) {
         vv /= maxv;
       }
-      return mcestimates;
     }
     
     std::vector<numeric_type>
@@ -208,26 +600,34 @@ namespace rti {
       return mcestimates;
     }
 
-    std::vector<util::quadruple<numeric_type> >
-    combine_points_with_grid_spacing_and_compute_max_disc_radius()
+    // Combines the points with the grid spacing (as radius) and the normals
+    // in the Embree compatible buffers (reusing their memory)
+    void fill_buffers_and_compute_max_disc_radius(scene& scene_)
     {
-      auto result = std::vector<util::quadruple<numeric_type> > {};
-      const auto num_spacings = spacing.size();
-      assert((points.size() == num_spacings || num_spacings == 1) && "Assumption");
-      maxDscRad = spacing[0];
-      auto sca = spacing[0];
-      result.reserve(points.size());
-      for (size_t idx = 0; idx < points.size(); ++idx) {
-        const auto& tri = points[idx];
+      auto const& pointsview = scene_.input.pointsview;
+      auto const& normalsview = scene_.input.normalsview;
+      auto const& spacingview = scene_.input.spacingview;
+      auto& buffers = scene_.buffers;
+      auto& maxDscRad = scene_.maxDscRad;
+      const auto num_spacings = spacingview.size;
+      assert((pointsview.size == num_spacings || num_spacings == 1) && "Assumption");
+      assert(pointsview.size == normalsview.size && "Assumption");
+      maxDscRad = spacingview[0][0];
+      auto sca = spacingview[0][0];
+      buffers.clear();
+      buffers.reserve(pointsview.size);
+      for (size_t idx = 0; idx < pointsview.size; ++idx) {
+        auto tri = pointsview[idx];
+        auto nml = normalsview[idx];
         if(num_spacings != 1){
-          sca = spacing[idx];
+          sca = spacingview[idx][0];
           if (maxDscRad < sca) {
             maxDscRad = sca;
           }
         }
-        result.push_back({tri[0], tri[1], tri[2], sca});
+        buffers.push_back(util::quadruple<numeric_type> {tri[0], tri[1], tri[2], sca},
+                          util::triple<numeric_type> {nml[0], nml[1], nml[2]});
       }
-      return result;
     }
 
     util::pair<util::triple<numeric_type> >
@@ -292,16 +692,34 @@ namespace rti {
     std::vector<util::triple<numeric_type> > points;
     std::vector<util::triple<numeric_type> > normals;
     std::vector<numeric_type> spacing;
+    strided_view pointsview;
+    strided_view normalsview;
+    strided_view spacingview;
     std::vector<numeric_type> mcestimates;
     std::vector<size_t> hitcnts;
+    util::timing_record timing;
 
     size_t numofrays = 1024;
-    numeric_type maxDscRad = 0.0;
+    size_t numofraystraced = 0;
+    bool cancelled = false;
+    double timebudget = 0;
 
     bound_condition xCond = geo::bound_condition::REFLECTIVE;
     bound_condition yCond = geo::bound_condition::REFLECTIVE;
 
     ray::cosine_direction_z<numeric_type> cosine; // default behaviour
     ray::i_direction<numeric_type>& direction = cosine;
+
+    bool keepscene = false;
+    // Increased by the setters; a kept scene is traced again only if its
+    // input has the current version
+    size_t inputversion = 0;
+    std::unique_ptr<scene> lastscene;
+    // Recycled by run(); see recycle_scene()
+    std::unique_ptr<scene> sparescene;
+
+    // Set by prepare_next(); the last member such that it is destroyed (and
+    // waited for) first
+    std::future<std::unique_ptr<scene> > nextscene;
   };
 }
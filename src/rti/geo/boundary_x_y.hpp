@@ -1,6 +1,7 @@
 #pragma once
 
 //#include <ostream>
+#include <limits>
 
 #include <embree3/rtcore.h>
 
@@ -34,6 +35,15 @@ namespace rti { namespace geo {
      util::pair<util::triple<Ty> >& pBdBox) :
       boundary_x_y(pDevice, pBdBox, bound_condition::REFLECTIVE, bound_condition::REFLECTIVE) {}
 
+    // A scene which contains this boundary holds a reference of its own
+    ~boundary_x_y()
+    {
+      rtcReleaseGeometry(mGeometry);
+    }
+
+    boundary_x_y(boundary_x_y const&) = delete;
+    boundary_x_y& operator=(boundary_x_y const&) = delete;
+
 
     
     RTCDevice& get_rtc_device() override final
@@ -142,6 +152,76 @@ namespace rti { namespace geo {
       return {util::triple<Ty> {0,0,0}, util::triple<Ty> {0,0,0}};
     }
 
+    // Analytic handling of the boundary (alternative to tracing the boundary
+    // triangles with Embree; see trace::tracer::set_analytic_boundary())
+
+    enum class wall { NONE, X_MIN, X_MAX, Y_MIN, Y_MAX };
+
+    // Returns the distance along the ray to the point where it leaves the
+    // bounding box through one of the walls spanned by the boundary triangles
+    // and sets pWall accordingly. If the ray does not hit a wall, then the
+    // result is infinity and pWall is wall::NONE.
+    Ty distance_to_wall(RTCRay const& pRay, wall& pWall) const
+    {
+      auto result = std::numeric_limits<Ty>::infinity();
+      pWall = wall::NONE;
+      if (pRay.dir_x != 0) {
+        auto xwall = pRay.dir_x > 0 ? wall::X_MAX : wall::X_MIN;
+        auto xx = pRay.dir_x > 0 ? mBdBox[1][0] : mBdBox[0][0];
+        auto tt = std::max((Ty) 0, (xx - pRay.org_x) / pRay.dir_x);
+        if (tt < result) {
+          result = tt;
+          pWall = xwall;
+        }
+      }
+      if (pRay.dir_y != 0) {
+        auto ywall = pRay.dir_y > 0 ? wall::Y_MAX : wall::Y_MIN;
+        auto yy = pRay.dir_y > 0 ? mBdBox[1][1] : mBdBox[0][1];
+        auto tt = std::max((Ty) 0, (yy - pRay.org_y) / pRay.dir_y);
+        if (tt < result) {
+          result = tt;
+          pWall = ywall;
+        }
+      }
+      // The walls span the bounding box in z-direction only
+      auto zz = pRay.org_z + pRay.dir_z * result;
+      if (pWall != wall::NONE && (zz < mBdBox[0][2] || mBdBox[1][2] < zz)) {
+        pWall = wall::NONE;
+        return std::numeric_limits<Ty>::infinity();
+      }
+      return result;
+    }
+
+    // Moves the origin of the ray to the point at distance pDistance (on pWall)
+    // and wraps (periodic) or reflects (reflective) the ray there. Equivalent to
+    // process_hit() on the corresponding boundary triangle.
+    void process_wall_hit(RTCRay& pRay, wall pWall, Ty pDistance) const
+    {
+      assert(pWall != wall::NONE && "Precondition");
+      pRay.org_x = pRay.org_x + pRay.dir_x * pDistance;
+      pRay.org_y = pRay.org_y + pRay.dir_y * pDistance;
+      pRay.org_z = pRay.org_z + pRay.dir_z * pDistance;
+      if (pWall == wall::X_MIN || pWall == wall::X_MAX) {
+        auto onmax = pWall == wall::X_MAX;
+        if (mXCond == bound_condition::REFLECTIVE) {
+          pRay.org_x = onmax ? mBdBox[1][0] : mBdBox[0][0];
+          pRay.dir_x = -pRay.dir_x;
+        } else {
+          assert(mXCond == bound_condition::PERIODIC && "Correctness Assumption");
+          pRay.org_x = onmax ? mBdBox[0][0] : mBdBox[1][0];
+        }
+        return;
+      }
+      auto onmax = pWall == wall::Y_MAX;
+      if (mYCond == bound_condition::REFLECTIVE) {
+        pRay.org_y = onmax ? mBdBox[1][1] : mBdBox[0][1];
+        pRay.dir_y = -pRay.dir_y;
+      } else {
+        assert(mYCond == bound_condition::PERIODIC && "Correctness Assumption");
+        pRay.org_y = onmax ? mBdBox[0][1] : mBdBox[1][1];
+      }
+    }
+
   private:
 
     void init_this()
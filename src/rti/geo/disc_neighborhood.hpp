@@ -1,24 +1,46 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "../util/array_view.hpp"
+#include "../util/logger.hpp"
+#include "../util/utils.hpp"
+
 namespace rti { namespace geo {
   template<typename numeric_type>
   class disc_neighborhood {
     
   public:
 
+    // The points (x, y, z, radius) are passed as a view such that they may be
+    // stored in a std::vector or in a buffer shared with Embree.
+    using points_view = util::array_view<rti::util::quadruple<numeric_type> const>;
+
     // disc_neighborhood() {}
 
     void setup_neighborhood_naive
-    (std::vector<rti::util::quadruple<numeric_type> >& points)
+    (points_view points)
     {
       nbhd.clear();
       nbhd.resize(points.size(), std::vector<size_t> {});
       construct_neighborhood_naive_1(points);
     }
 
+    // Same as setup_neighborhood_naive() but with early outs on the coordinates
+    // (see check_dist()).
+    void setup_neighborhood_naive_2
+    (points_view points)
+    {
+      nbhd.clear();
+      nbhd.resize(points.size(), std::vector<size_t> {});
+      construct_neighborhood_naive_2(points);
+    }
 
     void setup_neighborhood
-    (std::vector<rti::util::quadruple<numeric_type> >& points,
+    (points_view points,
      rti::util::triple<numeric_type>& min,
      rti::util::triple<numeric_type>& max)
     {
@@ -32,10 +54,15 @@ namespace rti { namespace geo {
       return nbhd[id];
     }
 
+    size_t size() const
+    {
+      return nbhd.size();
+    }
+
   private:
 
     void construct_neighborhood
-    (std::vector<rti::util::quadruple<numeric_type> >& points,
+    (points_view points,
      rti::util::triple<numeric_type>& min,
      rti::util::triple<numeric_type>& max)
     {
@@ -64,7 +91,7 @@ namespace rti { namespace geo {
     }
 
     void divide_and_conquer
-    (std::vector<rti::util::quadruple<numeric_type> > const& pointdata,
+    (points_view pointdata,
      std::vector<size_t> const& s1,
      std::vector<size_t> const& s2,
      numeric_type const& s1maxrad,
@@ -81,11 +108,36 @@ namespace rti { namespace geo {
       // Corner case
       // The pivot element should actually be inbetween min and max.
       if (pivot == min[diridx] || pivot == max[diridx]) {
-        // In this case the points are extremly close to each other (with respect
-        // to the floating point precision).
         assert( (min[diridx] + max[diridx]) / 2 == pivot && "Characterization of corner case");
         auto s1s2 = std::vector<size_t> (s1);
         s1s2.insert(s1s2.end(), s2.begin(), s2.end());
+        // The box is flat in the direction diridx (e.g., a part of a planar
+        // surface). If it is not flat in another direction, then split there.
+        for (auto offset = 1; offset < 3; ++offset) {
+          auto otherdiridx = (diridx + offset) % 3;
+          auto otherpivot = (max[otherdiridx] + min[otherdiridx]) / 2;
+          if (otherpivot == min[otherdiridx] || otherpivot == max[otherdiridx]) {
+            continue;
+          }
+          auto t1 = std::vector<size_t> {};
+          auto t2 = std::vector<size_t> {};
+          auto t1maxrad = (numeric_type) 0;
+          auto t2maxrad = (numeric_type) 0;
+          for (auto const& idx : s1s2) {
+            auto const& pp = pointdata[idx];
+            if (pp[otherdiridx] <= otherpivot) {
+              t1.push_back(idx);
+              t1maxrad = std::max(t1maxrad, pp[3]);
+            } else {
+              t2.push_back(idx);
+              t2maxrad = std::max(t2maxrad, pp[3]);
+            }
+          }
+          divide_and_conquer(pointdata, t1, t2, t1maxrad, t2maxrad, min, max, otherdiridx, otherpivot);
+          return;
+        }
+        // In this case the points are extremly close to each other (with respect
+        // to the floating point precision).
         // Add each of them to the neighborhoods
         for (size_t idx1 = 0; idx1 < s1s2.size()-1; ++idx1) {
           for (size_t idx2 = idx1+1; idx2 < s1s2.size(); ++idx2) {
@@ -188,7 +240,7 @@ namespace rti { namespace geo {
     }
 
    bool check_dist
-   (std::vector<rti::util::quadruple<numeric_type> > const& pointdata,
+   (points_view pointdata,
     size_t const& i1,
     size_t const& i2,
     int const& diridx)
@@ -219,13 +271,13 @@ namespace rti { namespace geo {
       return false;
     }
     
-    void construct_neighborhood_naive_1(std::vector<rti::util::quadruple<numeric_type> > const& points)
+    void construct_neighborhood_naive_1(points_view points)
     {
-      std::cout << "points.size() == " << points.size() << std::endl;
-      std::cout << "Starting the quadratic loop v1" << std::endl;
+      RLOG_DEBUG << "points.size() == " << points.size() << std::endl;
+      RLOG_DEBUG << "Starting the quadratic loop v1" << std::endl;
       //#pragma omp parallel for
       for (size_t idx1 = 0; idx1 < points.size(); ++idx1) {
-        for (size_t idx2 = idx1; idx2 < points.size(); ++idx2) {
+        for (size_t idx2 = idx1 + 1; idx2 < points.size(); ++idx2) {
           auto& p1 = points[idx1];
           auto& r1 = p1[3];
           auto& p2 = points[idx2];
@@ -242,14 +294,16 @@ namespace rti { namespace geo {
       }
     }
 
-    void construct_neighborhood_naive_2(std::vector<rti::util::quadruple<numeric_type> > const& points)
+    void construct_neighborhood_naive_2(points_view points)
     {
-      std::cout << "points.size() == " << points.size() << std::endl;
-      std::cout << "Starting the quadratic loop v2" << std::endl;
+      RLOG_DEBUG << "points.size() == " << points.size() << std::endl;
+      RLOG_DEBUG << "Starting the quadratic loop v2" << std::endl;
       // #pragma omp parallel for
       for (size_t idx1 = 0; idx1 < points.size(); ++idx1) {
-        for (size_t idx2 = idx1; idx2 < points.size(); ++idx2) {
-          if ( check_dist(points, idx1, idx2, 0) ) {
+        for (size_t idx2 = idx1 + 1; idx2 < points.size(); ++idx2) {
+          // check_dist() expects the points in ascending order in the given direction
+          auto ordered = points[idx1][0] <= points[idx2][0];
+          if ( check_dist(points, ordered ? idx1 : idx2, ordered ? idx2 : idx1, 0) ) {
             nbhd[idx1].push_back(idx2);
             nbhd[idx2].push_back(idx1);
           }
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+#include "point_cloud_disc_geometry.hpp"
+#include "../util/array_view.hpp"
+#include "../util/utils.hpp"
+
+namespace rti { namespace geo {
+
+  // A compact, read-only copy of the data of a point_cloud_disc_geometry
+  // which the tracer reads on every hit: the discs, the normals and the
+  // neighborhood (in compressed sparse row form instead of one vector per
+  // disc).
+  //
+  // The tracer keeps one copy per NUMA node (see tracer::set_numa_replication());
+  // every copy is made by a thread of its node such that its pages are local
+  // to that node (first touch).
+  template<typename numeric_type>
+  class disc_side_tables {
+  public:
+    // Precondition: the neighborhood of pGeometry has been built
+    disc_side_tables(point_cloud_disc_geometry<numeric_type>& pGeometry)
+    {
+      assert(pGeometry.has_neighborhood() && "Precondition");
+      auto numprims = pGeometry.get_num_primitives();
+      mPrims.reserve(numprims);
+      mNormals.reserve(numprims);
+      mNeighborOffsets.reserve(numprims + 1);
+      mNeighborOffsets.push_back(0);
+      for (unsigned int idx = 0; idx < numprims; ++idx) {
+        mPrims.push_back(pGeometry.get_prim_ref(idx));
+        mNormals.push_back(pGeometry.get_normal_ref(idx));
+        for (auto nb : pGeometry.get_neighbors(idx)) {
+          mNeighbors.push_back((unsigned int) nb);
+        }
+        mNeighborOffsets.push_back(mNeighbors.size());
+      }
+    }
+
+    util::quadruple<numeric_type> const& get_prim_ref(unsigned int pPrimID) const
+    {
+      return mPrims[pPrimID];
+    }
+
+    util::triple<numeric_type> const& get_normal_ref(unsigned int pPrimID) const
+    {
+      return mNormals[pPrimID];
+    }
+
+    util::array_view<unsigned int const> get_neighbors(unsigned int pPrimID) const
+    {
+      auto first = mNeighborOffsets[pPrimID];
+      return {mNeighbors.data() + first, mNeighborOffsets[pPrimID + 1] - first};
+    }
+
+  private:
+    std::vector<util::quadruple<numeric_type> > mPrims;
+    std::vector<util::triple<numeric_type> > mNormals;
+    std::vector<size_t> mNeighborOffsets;
+    std::vector<unsigned int> mNeighbors;
+  };
+}} // namespace
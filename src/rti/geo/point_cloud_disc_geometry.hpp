@@ -6,7 +6,10 @@
 #include "disc_neighborhood.hpp"
 #include "meta_geometry.hpp"
 #include "../io/i_point_cloud_reader.hpp"
+#include "../io/point_cloud_buffers.hpp"
+#include "../io/rtipc_point_cloud_reader.hpp"
 #include "../util/timer.hpp"
+#include "../util/timing.hpp"
 #include "../util/utils.hpp"
 
 namespace rti { namespace geo {
@@ -31,6 +34,32 @@ namespace rti { namespace geo {
       init_this(mDevice, points, normals);
     }
 
+    // Borrows the memory mapped buffers of the reader (no copies); the reader
+    // has to outlive this geometry.
+    point_cloud_disc_geometry
+    (RTCDevice& pDevice, io::rtipc_point_cloud_reader<numeric_type>& pReader) :
+      mDevice(pDevice),
+      mInfilename(pReader.get_input_file_name()) {
+      init_this_shared(mDevice, pReader);
+    }
+
+    // Borrows the buffers (no copies); they have to outlive this geometry.
+    point_cloud_disc_geometry
+    (RTCDevice& pDevice, io::point_cloud_buffers& pBuffers) :
+      mDevice(pDevice),
+      mInfilename("") {
+      init_this_shared(mDevice, pBuffers);
+    }
+
+    // A scene which contains this geometry holds a reference of its own
+    ~point_cloud_disc_geometry()
+    {
+      rtcReleaseGeometry(mGeometry);
+    }
+
+    point_cloud_disc_geometry(point_cloud_disc_geometry const&) = delete;
+    point_cloud_disc_geometry& operator=(point_cloud_disc_geometry const&) = delete;
+
     std::string prim_to_string(unsigned int pPrimID)
     {
       assert(false && "Not implemented");
@@ -100,11 +129,49 @@ namespace rti { namespace geo {
       pOs << ")";
     }
 
+    // Sets up the neighborhood of the discs unless that has been done before.
+    // The neighborhood is needed by get_neighbors() only; hence, it is not
+    // built on construction.
+    void build_neighborhood()
+    {
+      if (mHasNeighborhood) {
+        return;
+      }
+      // The durations of the children are included in the geometry
+      auto geometryprobe = util::timing_probe {mTiming};
+      auto nbhdprobe = util::timing_probe {mTiming.child("neighborhood")};
+      if constexpr (std::is_same<numeric_type, float>::value) {
+        // The vertex buffer has the layout of util::quadruple<float>
+        discnbhd.setup_neighborhood
+          ({reinterpret_cast<util::quadruple<numeric_type> const*>(mVVBuffer), mNumPoints}, mincoords, maxcoords);
+      } else {
+        auto points = std::vector<util::quadruple<numeric_type> > (mNumPoints);
+        for (size_t idx = 0; idx < mNumPoints; ++idx) {
+          points[idx] = get_prim(idx);
+        }
+        discnbhd.setup_neighborhood(points, mincoords, maxcoords);
+      }
+      mHasNeighborhood = true;
+    }
+
+    bool has_neighborhood() const
+    {
+      return mHasNeighborhood;
+    }
+
+    // Precondition: build_neighborhood() has been called
     std::vector<size_t>& get_neighbors(unsigned int id)
     {
+      assert(mHasNeighborhood && "Precondition");
       return discnbhd.get_neighbors(id);
     }
 
+    // Durations of the phases of the construction of this geometry
+    util::timing_record const& get_timing()
+    {
+      return mTiming;
+    }
+
   private:
 
     void init_this
@@ -116,6 +183,35 @@ namespace rti { namespace geo {
       init_this(device, points, normals);
     }
 
+    // The parameter buffers_type is either io::point_cloud_buffers or
+    // io::rtipc_point_cloud_reader.
+    template<typename buffers_type>
+    void init_this_shared
+    (RTCDevice& device,
+     buffers_type& pbuffers)
+    {
+      static_assert(std::is_same<numeric_type, float>::value,
+                    "Error: Embree buffers can be shared only in single precision.");
+      auto geometryprobe = util::timing_probe {mTiming};
+      auto buffersprobe = util::timing_probe {mTiming.child("buffers")};
+      mGeometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_ORIENTED_DISC_POINT);
+      mNumPoints = pbuffers.get_num_points();
+      mVVBuffer = reinterpret_cast<point_4f_t*>(pbuffers.get_point_buffer());
+      mNNBuffer = reinterpret_cast<normal_vec_3f_t*>(pbuffers.get_normal_buffer());
+      // Both buffer types guarantee the alignment and the padding which Embree
+      // requires for shared buffers.
+      rtcSetSharedGeometryBuffer
+        (mGeometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT4, mVVBuffer, 0, sizeof(point_4f_t), mNumPoints);
+      rtcSetSharedGeometryBuffer
+        (mGeometry, RTC_BUFFER_TYPE_NORMAL, 0, RTC_FORMAT_FLOAT3, mNNBuffer, 0, sizeof(normal_vec_3f_t), mNumPoints);
+      mincoords = pbuffers.get_min();
+      maxcoords = pbuffers.get_max();
+      maxradius = pbuffers.get_max_radius();
+      rtcCommitGeometry(mGeometry);
+      assert (RTC_ERROR_NONE == rtcGetDeviceError(device) &&
+              "Embree device error after rtcSetSharedGeometryBuffer()");
+    }
+
     void init_this
     (RTCDevice& device,
      std::vector<util::quadruple<numeric_type> > points,
@@ -174,6 +270,8 @@ namespace rti { namespace geo {
       // information, u and v are set to zero."
       // Source: https://www.embree.org/api.html#rtc_geometry_type_point
 
+      auto geometryprobe = util::timing_probe {mTiming};
+      auto buffersprobe = util::timing_probe {mTiming.child("buffers")};
       // using a ray facing discs
       mGeometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_ORIENTED_DISC_POINT);
       mNumPoints = points.size();
@@ -222,13 +320,6 @@ namespace rti { namespace geo {
       rtcCommitGeometry(mGeometry);
       assert (RTC_ERROR_NONE == rtcGetDeviceError(device) &&
               "Embree device error after rtcSetNewGeometryBuffer()");
-
-      // std::cout << "Creating neighborhood ... " << std::flush;
-      // auto timer = util::timer {};
-      // // discnbhd.setup_neighborhood_naive(points);
-      discnbhd.setup_neighborhood(points, mincoords, maxcoords);
-      // auto elapsed = timer.elapsed_seconds();
-      // std::cout << " took " << elapsed << " seconds" << std::endl;
     }
 
   private:
@@ -258,6 +349,8 @@ namespace rti { namespace geo {
     size_t mNumPoints = 0;
     std::string mInfilename;
     geo::disc_neighborhood<numeric_type> discnbhd;
+    bool mHasNeighborhood = false;
+    util::timing_record mTiming {"geometry"};
 
     constexpr static numeric_type nummax = std::numeric_limits<numeric_type>::max();
     constexpr static numeric_type nummin = std::numeric_limits<numeric_type>::lowest();
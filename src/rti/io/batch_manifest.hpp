@@ -0,0 +1,133 @@
+#pragma once
+
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The manifest of a batch of runs (see rti-batch)
+//
+// Every line describes one job: the input file and the output file followed
+// by optional parameters of the form key=value. Parameters which are not
+// given are taken from the command line of rti-batch. Empty lines and lines
+// starting with '#' are ignored. Example:
+//
+//   # input             output                 parameters
+//   input/trench.rtipc  output/trench-0.2.vtp  sticking-coefficient=0.2 number-of-rays=80000000
+//   input/trench.rtipc  output/trench-0.8.vtp  sticking-coefficient=0.8 repetitions=20
+//
+// The keys are sticking-coefficient, number-of-rays, time-budget (seconds)
+// and repetitions. A job with k > 1 repetitions traces the input k times
+// with different random number streams and writes <output>.<i>.vtp for
+// i = 0, ..., k - 1.
+
+namespace rti { namespace io {
+
+  struct batch_job {
+    std::string infile;
+    std::string outfile;
+    float stickingC = 0.8f;
+    // Zero stands for the default number of rays of rti (or an unlimited
+    // number of rays if a time budget is given)
+    unsigned long long numRays = 0;
+    double timeBudget = 0;
+    unsigned int repetitions = 1;
+  };
+
+  class batch_manifest {
+  public:
+    // Reads the jobs of a manifest and appends them to pJobs. Returns false
+    // and describes the first error in pError if the manifest is malformed.
+    static
+    bool read(std::istream& pIn, batch_job const& pDefaults,
+              std::vector<batch_job>& pJobs, std::string& pError)
+    {
+      auto linenum = 0u;
+      for (auto line = std::string {}; std::getline(pIn, line);) {
+        linenum += 1;
+        auto linestream = std::istringstream {line};
+        auto job = pDefaults;
+        if ( ! (linestream >> job.infile) || job.infile[0] == '#') {
+          continue; // empty line or comment
+        }
+        if ( ! (linestream >> job.outfile)) {
+          pError = "line " + std::to_string(linenum) + ": missing output file";
+          return false;
+        }
+        for (auto param = std::string {}; linestream >> param;) {
+          if ( ! parse_param(param, job)) {
+            pError = "line " + std::to_string(linenum) + ": invalid parameter \"" + param + "\"";
+            return false;
+          }
+        }
+        pJobs.push_back(job);
+      }
+      return true;
+    }
+
+    static
+    bool read(std::string const& pFilename, batch_job const& pDefaults,
+              std::vector<batch_job>& pJobs, std::string& pError)
+    {
+      auto in = std::ifstream {pFilename};
+      if ( ! in) {
+        pError = "cannot open " + pFilename;
+        return false;
+      }
+      return read(in, pDefaults, pJobs, pError);
+    }
+
+    // The output file of repetition pRepetition of pJob; like rti, appends
+    // .vtp if the output file of the job does not end with it.
+    static
+    std::string get_outfile(batch_job const& pJob, unsigned int pRepetition)
+    {
+      auto base = pJob.outfile;
+      auto const ext = std::string {".vtp"};
+      if (base.size() >= ext.size() && base.compare(base.size() - ext.size(), ext.size(), ext) == 0) {
+        base.resize(base.size() - ext.size());
+      }
+      if (pJob.repetitions <= 1) {
+        return base + ext;
+      }
+      return base + "." + std::to_string(pRepetition) + ext;
+    }
+
+  private:
+    static
+    bool parse_param(std::string const& pParam, batch_job& pJob)
+    {
+      auto eq = pParam.find('=');
+      if (eq == std::string::npos) {
+        return false;
+      }
+      auto key = pParam.substr(0, eq);
+      auto value = pParam.substr(eq + 1);
+      try {
+        auto pos = size_t {0};
+        if (key == "sticking-coefficient") {
+          pJob.stickingC = std::stof(value, &pos);
+          if ( ! (0 < pJob.stickingC && pJob.stickingC <= 1)) {
+            return false;
+          }
+        } else if (key == "number-of-rays") {
+          pJob.numRays = std::stoull(value, &pos);
+        } else if (key == "time-budget") {
+          pJob.timeBudget = std::stod(value, &pos);
+        } else if (key == "repetitions") {
+          auto repetitions = std::stoul(value, &pos);
+          if (repetitions == 0) {
+            return false;
+          }
+          pJob.repetitions = (unsigned int) repetitions;
+        } else {
+          return false;
+        }
+        return pos == value.size();
+      } catch (...) {
+        return false;
+      }
+    }
+  };
+}} // namespace
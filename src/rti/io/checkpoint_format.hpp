@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shard_format.hpp"
+#include "../trace/epoch_reducer.hpp"
+#include "../trace/hit_accumulator.hpp"
+
+// The file format of the checkpoints of the tracer (file extension .rtickpt;
+// see tracer::set_checkpoint())
+//
+// The file consists of a header, the progress of every thread, and the sums
+// of the accumulator in the layout of io::shard_format. The progress of a
+// thread consists of four uint64 counters followed by its random number
+// states. Every state is written as a uint32 length followed by the textual
+// representation of the std::mt19937_64 engine (which is exact).
+
+namespace rti { namespace io {
+
+  class checkpoint_format {
+  public:
+    static constexpr char sMagic[8] = {'R', 'T', 'I', 'C', 'K', 'P', 'T', '0'};
+    static constexpr uint32_t sVersion = 1;
+
+    struct header {
+      char magic[8];
+      uint32_t version;
+      uint32_t headersize;
+      uint64_t numprims;
+      // The total number of rays of the run
+      uint64_t numrays;
+      uint64_t numthreads;
+      uint64_t raysperepoch;
+      // The number of epochs which have been added to the sums
+      uint64_t numepochs;
+      // The total number of hits (see hit_accumulator::get_cnts_sum())
+      uint64_t totalcnts;
+    };
+
+    template<typename numeric_type>
+    struct content {
+      header hh;
+      std::vector<trace::thread_progress> progress;
+      std::unique_ptr<trace::hit_accumulator<numeric_type> > acc;
+    };
+
+    // Writes the checkpoint to a temporary file which then replaces
+    // pFilename; hence, pFilename always holds a complete checkpoint.
+    // Returns false on failure.
+    template<typename numeric_type>
+    static
+    bool write(std::string const& pFilename,
+               uint64_t pNumRays,
+               uint64_t pRaysPerEpoch,
+               uint64_t pNumEpochs,
+               trace::hit_accumulator<numeric_type>& pAcc,
+               std::vector<trace::thread_progress> const& pProgress)
+    {
+      auto hh = header {};
+      std::memcpy(hh.magic, sMagic, sizeof(hh.magic));
+      hh.version = sVersion;
+      hh.headersize = sizeof(header);
+      hh.numprims = pAcc.get_s1s().size();
+      hh.numrays = pNumRays;
+      hh.numthreads = pProgress.size();
+      hh.raysperepoch = pRaysPerEpoch;
+      hh.numepochs = pNumEpochs;
+      hh.totalcnts = pAcc.get_cnts_sum();
+      auto tmpfilename = pFilename + ".tmp";
+      {
+        auto out = std::ofstream {tmpfilename, std::ios::binary | std::ios::trunc};
+        if ( ! out) {
+          return false;
+        }
+        out.write(reinterpret_cast<char const*>(&hh), sizeof(hh));
+        for (auto const& pp : pProgress) {
+          auto counters = std::array<uint64_t, 4> {pp.raysdone, pp.hitc, pp.nonhitc, pp.reflectc};
+          out.write(reinterpret_cast<char const*>(counters.data()), sizeof(counters));
+          for (auto const& rs : pp.rngstates) {
+            auto stream = std::ostringstream {};
+            stream << rs.mMT;
+            auto str = stream.str();
+            auto length = (uint32_t) str.size();
+            out.write(reinterpret_cast<char const*>(&length), sizeof(length));
+            out.write(str.data(), length);
+          }
+        }
+        shard_format::write_sums(out, pAcc);
+        if ( ! out) {
+          return false;
+        }
+      }
+      return std::rename(tmpfilename.c_str(), pFilename.c_str()) == 0;
+    }
+
+    // Reads a checkpoint. Returns false if the file cannot be read or is not
+    // a checkpoint of this version.
+    template<typename numeric_type>
+    static
+    bool read(std::string const& pFilename, content<numeric_type>& pContent)
+    {
+      auto in = std::ifstream {pFilename, std::ios::binary};
+      if ( ! in) {
+        return false;
+      }
+      auto& hh = pContent.hh;
+      in.read(reinterpret_cast<char*>(&hh), sizeof(hh));
+      if ( ! in ||
+           std::memcmp(hh.magic, sMagic, sizeof(hh.magic)) != 0 ||
+           hh.version != sVersion ||
+           hh.headersize != sizeof(header)) {
+        return false;
+      }
+      pContent.progress.resize(hh.numthreads);
+      for (auto& pp : pContent.progress) {
+        auto counters = std::array<uint64_t, 4> {};
+        in.read(reinterpret_cast<char*>(counters.data()), sizeof(counters));
+        pp.raysdone = counters[0];
+        pp.hitc = counters[1];
+        pp.nonhitc = counters[2];
+        pp.reflectc = counters[3];
+        for (auto& rs : pp.rngstates) {
+          auto length = (uint32_t) 0;
+          in.read(reinterpret_cast<char*>(&length), sizeof(length));
+          auto str = std::string (length, '\0');
+          in.read(&str[0], length);
+          auto stream = std::istringstream {str};
+          stream >> rs.mMT;
+          if ( ! in || ! stream) {
+            return false;
+          }
+        }
+      }
+      pContent.acc = shard_format::read_sums<numeric_type>(in, hh.numprims, hh.totalcnts);
+      return pContent.acc != nullptr;
+    }
+  };
+}} // namespace
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <utility>
+
+#include "../util/array_view.hpp"
+#include "../util/utils.hpp"
+
+namespace rti { namespace io {
+  // Owns the discs (x, y, z, radius; RTC_FORMAT_FLOAT4) and the normals
+  // (x, y, z; RTC_FORMAT_FLOAT3) of a point cloud in buffers which satisfy the
+  // requirements of rtcSetSharedGeometryBuffer(): both arrays are aligned to
+  // sAlignment bytes and padded such that Embree may read the last element
+  // with a 16 byte load. Readers fill these buffers directly and a geometry
+  // borrows them (see geo::point_cloud_disc_geometry), so the point cloud is
+  // stored only once. The bounding box is updated on insertion.
+  class point_cloud_buffers {
+  public:
+    static constexpr size_t sAlignment = 64;
+    static constexpr size_t sPadding = 16;
+
+    point_cloud_buffers() = default;
+
+    point_cloud_buffers(point_cloud_buffers const&) = delete;
+    point_cloud_buffers& operator=(point_cloud_buffers const&) = delete;
+
+    point_cloud_buffers(point_cloud_buffers&& pOther) noexcept
+    {
+      swap(pOther);
+    }
+
+    point_cloud_buffers& operator=(point_cloud_buffers&& pOther) noexcept
+    {
+      swap(pOther);
+      return *this;
+    }
+
+    ~point_cloud_buffers()
+    {
+      std::free(mPoints);
+      std::free(mNormals);
+    }
+
+    void reserve(size_t pCapacity)
+    {
+      if (pCapacity <= mCapacity) {
+        return;
+      }
+      auto points = allocate(4 * pCapacity);
+      auto normals = allocate(3 * pCapacity);
+      if (mSize > 0) {
+        std::memcpy(points, mPoints, 4 * mSize * sizeof(float));
+        std::memcpy(normals, mNormals, 3 * mSize * sizeof(float));
+      }
+      std::free(mPoints);
+      std::free(mNormals);
+      mPoints = points;
+      mNormals = normals;
+      mCapacity = pCapacity;
+    }
+
+    // Removes all points but keeps the memory
+    void clear()
+    {
+      mSize = 0;
+      mMin = {nummax, nummax, nummax};
+      mMax = {nummin, nummin, nummin};
+      mMaxRadius = 0;
+    }
+
+    template<typename numeric_type>
+    void push_back(util::quadruple<numeric_type> const& pPoint, util::triple<numeric_type> const& pNormal)
+    {
+      if (mSize == mCapacity) {
+        reserve(std::max<size_t>(2 * mCapacity, 1024));
+      }
+      auto pp = mPoints + 4 * mSize;
+      auto nn = mNormals + 3 * mSize;
+      for (size_t dim = 0; dim < 3; ++dim) {
+        pp[dim] = (float) pPoint[dim];
+        nn[dim] = (float) pNormal[dim];
+        mMin[dim] = std::min(mMin[dim], pp[dim]);
+        mMax[dim] = std::max(mMax[dim], pp[dim]);
+      }
+      pp[3] = (float) pPoint[3];
+      mMaxRadius = std::max(mMaxRadius, pp[3]);
+      mSize += 1;
+    }
+
+    size_t get_num_points() const
+    {
+      return mSize;
+    }
+
+    float* get_point_buffer()
+    {
+      return mPoints;
+    }
+
+    float* get_normal_buffer()
+    {
+      return mNormals;
+    }
+
+    util::array_view<util::quadruple<float> const> get_points_view() const
+    {
+      return {reinterpret_cast<util::quadruple<float> const*>(mPoints), mSize};
+    }
+
+    util::array_view<util::triple<float> const> get_normals_view() const
+    {
+      return {reinterpret_cast<util::triple<float> const*>(mNormals), mSize};
+    }
+
+    util::triple<float> get_min() const
+    {
+      return mMin;
+    }
+
+    util::triple<float> get_max() const
+    {
+      return mMax;
+    }
+
+    float get_max_radius() const
+    {
+      return mMaxRadius;
+    }
+
+  private:
+    static
+    float* allocate(size_t pNumFloats)
+    {
+      // std::aligned_alloc() requires a multiple of the alignment as size
+      auto bytes = pNumFloats * sizeof(float) + sPadding;
+      bytes = (bytes + sAlignment - 1) / sAlignment * sAlignment;
+      auto result = static_cast<float*>(std::aligned_alloc(sAlignment, bytes));
+      if (result == nullptr) {
+        throw std::bad_alloc {};
+      }
+      std::memset(result + pNumFloats, 0, bytes - pNumFloats * sizeof(float));
+      return result;
+    }
+
+    void swap(point_cloud_buffers& pOther) noexcept
+    {
+      std::swap(mPoints, pOther.mPoints);
+      std::swap(mNormals, pOther.mNormals);
+      std::swap(mSize, pOther.mSize);
+      std::swap(mCapacity, pOther.mCapacity);
+      std::swap(mMin, pOther.mMin);
+      std::swap(mMax, pOther.mMax);
+      std::swap(mMaxRadius, pOther.mMaxRadius);
+    }
+
+    static constexpr float nummax = std::numeric_limits<float>::max();
+    static constexpr float nummin = std::numeric_limits<float>::lowest();
+
+    float* mPoints = nullptr;
+    float* mNormals = nullptr;
+    size_t mSize = 0;
+    size_t mCapacity = 0;
+    util::triple<float> mMin {nummax, nummax, nummax};
+    util::triple<float> mMax {nummin, nummin, nummin};
+    float mMaxRadius = 0;
+  };
+}} // namespace
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../util/ray_logger.hpp"
+#include "../util/utils.hpp"
+
+namespace rti { namespace io {
+  // Reads a binary ray log as written by rti::util::ray_logger.
+  class ray_log_reader {
+  public:
+    ray_log_reader(std::string const& pFilename) :
+      mInfilename(pFilename) {
+      auto in = std::ifstream {pFilename, std::ios::binary};
+      if ( ! in ) {
+        std::cerr << "Error: " << typeid(this).name() << " could not open " << pFilename << std::endl;
+        return;
+      }
+      auto hh = util::ray_logger::header {};
+      in.read(reinterpret_cast<char*>(&hh), sizeof(hh));
+      if ( ! in ||
+           std::memcmp(hh.magic, util::ray_logger::sMagic, sizeof(hh.magic)) != 0 ||
+           hh.version != util::ray_logger::sVersion ||
+           hh.recordsize != sizeof(util::ray_logger::record)) {
+        std::cerr
+          << "Error: " << typeid(this).name() << " the file " << pFilename
+          << " is not a ray log of version " << util::ray_logger::sVersion << std::endl;
+        return;
+      }
+      auto rr = util::ray_logger::record {};
+      while (in.read(reinterpret_cast<char*>(&rr), sizeof(rr))) {
+        auto p1 = util::triple<float> {rr.p1[0], rr.p1[1], rr.p1[2]};
+        if (rr.kind == (uint32_t) util::ray_logger::record_kind::SOURCE) {
+          mSources.push_back(p1);
+          continue;
+        }
+        assert(rr.kind == (uint32_t) util::ray_logger::record_kind::SEGMENT && "Correctness Assumption");
+        mSegments.push_back({p1, util::triple<float> {rr.p2[0], rr.p2[1], rr.p2[2]}});
+      }
+      mValid = true;
+    }
+
+    bool is_valid() const
+    {
+      return mValid;
+    }
+
+    std::vector<util::pair<util::triple<float> > >& get_segments()
+    {
+      return mSegments;
+    }
+
+    std::vector<util::triple<float> >& get_sources()
+    {
+      return mSources;
+    }
+
+    std::string get_input_file_name() const
+    {
+      return mInfilename;
+    }
+
+  private:
+    std::string mInfilename;
+    bool mValid = false;
+    std::vector<util::pair<util::triple<float> > > mSegments;
+    std::vector<util::triple<float> > mSources;
+  };
+}}
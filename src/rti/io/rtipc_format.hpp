@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "../util/array_view.hpp"
+#include "../util/utils.hpp"
+
+// The native binary point cloud format of rti (file extension .rtipc)
+//
+// The file consists of a header followed by two arrays which can be handed to
+// Embree as they are (see rtcSetSharedGeometryBuffer()):
+//   - the discs as (x, y, z, radius) in single precision (RTC_FORMAT_FLOAT4)
+//   - the normals as (x, y, z) in single precision (RTC_FORMAT_FLOAT3)
+// Both arrays start at offsets which are multiples of sAlignment. The file
+// ends with sPadding zero bytes such that Embree may read the last normal with
+// a 16 byte load. All values are stored in the byte order of the machine
+// which wrote the file (little endian on all our targets).
+
+namespace rti { namespace io {
+
+  class rtipc_format {
+  public:
+    static constexpr char sMagic[8] = {'R', 'T', 'I', 'P', 'C', 'B', 'I', 'N'};
+    static constexpr uint32_t sVersion = 1;
+    static constexpr uint64_t sAlignment = 64;
+    static constexpr uint64_t sPadding = 16;
+    static constexpr uint64_t sPointSize = 4 * sizeof(float);
+    static constexpr uint64_t sNormalSize = 3 * sizeof(float);
+
+    struct header {
+      char magic[8];
+      uint32_t version;
+      uint32_t headersize;
+      uint64_t numpoints;
+      uint64_t pointsoffset;
+      uint64_t normalsoffset;
+      // The bounding box of the centers of the discs and the maximal radius
+      float min[3];
+      float max[3];
+      float maxradius;
+      uint32_t reserved;
+    };
+
+    static
+    uint64_t align(uint64_t pOffset)
+    {
+      return (pOffset + sAlignment - 1) / sAlignment * sAlignment;
+    }
+
+    // Returns the header of a file with pNumPoints points; the bounding box
+    // is left empty.
+    static
+    header make_header(uint64_t pNumPoints)
+    {
+      auto hh = header {};
+      std::memcpy(hh.magic, sMagic, sizeof(hh.magic));
+      hh.version = sVersion;
+      hh.headersize = sizeof(header);
+      hh.numpoints = pNumPoints;
+      hh.pointsoffset = align(sizeof(header));
+      hh.normalsoffset = align(hh.pointsoffset + pNumPoints * sPointSize);
+      return hh;
+    }
+
+    static
+    uint64_t file_size(header const& pHeader)
+    {
+      return pHeader.normalsoffset + pHeader.numpoints * sNormalSize + sPadding;
+    }
+
+    // Writes the discs (x, y, z, radius) and their normals to pFilename.
+    // Returns false on failure.
+    template<typename numeric_type>
+    static
+    bool write(util::array_view<util::quadruple<numeric_type> const> pPoints,
+               util::array_view<util::triple<numeric_type> const> pNormals,
+               std::string const& pFilename)
+    {
+      if (pPoints.size() != pNormals.size()) {
+        return false;
+      }
+      auto hh = make_header(pPoints.size());
+      auto nummax = std::numeric_limits<float>::max();
+      auto nummin = std::numeric_limits<float>::lowest();
+      for (size_t dim = 0; dim < 3; ++dim) {
+        hh.min[dim] = nummax;
+        hh.max[dim] = nummin;
+      }
+      hh.maxradius = 0;
+      for (auto const& pp : pPoints) {
+        for (size_t dim = 0; dim < 3; ++dim) {
+          hh.min[dim] = std::min(hh.min[dim], (float) pp[dim]);
+          hh.max[dim] = std::max(hh.max[dim], (float) pp[dim]);
+        }
+        hh.maxradius = std::max(hh.maxradius, (float) pp[3]);
+      }
+      auto out = std::ofstream {pFilename, std::ios::binary | std::ios::trunc};
+      if ( ! out) {
+        return false;
+      }
+      out.write(reinterpret_cast<char const*>(&hh), sizeof(hh));
+      pad(out, hh.pointsoffset);
+      write_floats<4>(out, pPoints);
+      pad(out, hh.normalsoffset);
+      write_floats<3>(out, pNormals);
+      pad(out, file_size(hh));
+      return (bool) out;
+    }
+
+  private:
+    static
+    void pad(std::ofstream& pOut, uint64_t pOffset)
+    {
+      auto zeros = std::vector<char> (pOffset - (uint64_t) pOut.tellp(), 0);
+      pOut.write(zeros.data(), zeros.size());
+    }
+
+    // Converts the elements to single precision and writes them in chunks
+    template<size_t dim, typename array_type>
+    static
+    void write_floats(std::ofstream& pOut, util::array_view<array_type const> pArray)
+    {
+      constexpr size_t chunksize = 1 << 16;
+      auto buffer = std::vector<float> {};
+      buffer.reserve(dim * chunksize);
+      for (size_t start = 0; start < pArray.size(); start += chunksize) {
+        buffer.clear();
+        auto end = std::min(start + chunksize, pArray.size());
+        for (size_t idx = start; idx < end; ++idx) {
+          for (size_t dd = 0; dd < dim; ++dd) {
+            buffer.push_back((float) pArray[idx][dd]);
+          }
+        }
+        pOut.write(reinterpret_cast<char const*>(buffer.data()), buffer.size() * sizeof(float));
+      }
+    }
+  };
+}} // namespace
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "i_point_cloud_reader.hpp"
+#include "rtipc_format.hpp"
+#include "../util/array_view.hpp"
+#include "../util/utils.hpp"
+
+namespace rti { namespace io {
+  // Maps a point cloud in the native binary format (see rtipc_format) into
+  // memory. Nothing is parsed or copied; the pages are loaded on first access.
+  // The mapping is private (copy on write), that is, modifications of the
+  // buffers are never written back to the file.
+  //
+  // A geometry which borrows the buffers of this reader (see
+  // geo::point_cloud_disc_geometry) must not outlive the reader.
+  template<typename numeric_type>
+  class rtipc_point_cloud_reader : public i_point_cloud_reader<numeric_type> {
+  public:
+    rtipc_point_cloud_reader(std::string const& pFilename) :
+      mInfilename(pFilename) {
+      auto fd = open(pFilename.c_str(), O_RDONLY);
+      if (fd == -1) {
+        std::cerr << "Error: " << typeid(this).name() << " could not open " << pFilename << std::endl;
+        return;
+      }
+      struct stat st;
+      if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(rtipc_format::header)) {
+        mSize = st.st_size;
+        auto addr = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+          mData = static_cast<char*>(addr);
+        }
+      }
+      close(fd); // the mapping stays valid
+      if (mData == nullptr || ! check_header()) {
+        std::cerr
+          << "Error: " << typeid(this).name() << " the file " << pFilename
+          << " is not a point cloud of version " << rtipc_format::sVersion << std::endl;
+        unmap();
+        return;
+      }
+      // Embree and the neighborhood construction read the whole file anyway
+      madvise(mData, mSize, MADV_WILLNEED);
+    }
+
+    rtipc_point_cloud_reader(rtipc_point_cloud_reader const&) = delete;
+    rtipc_point_cloud_reader& operator=(rtipc_point_cloud_reader const&) = delete;
+
+    ~rtipc_point_cloud_reader()
+    {
+      unmap();
+    }
+
+    bool is_valid() const
+    {
+      return mData != nullptr;
+    }
+
+    size_t get_num_points() const
+    {
+      return is_valid() ? get_header().numpoints : 0;
+    }
+
+    // The discs as (x, y, z, radius); RTC_FORMAT_FLOAT4
+    float* get_point_buffer()
+    {
+      return reinterpret_cast<float*>(mData + get_header().pointsoffset);
+    }
+
+    // The normals as (x, y, z); RTC_FORMAT_FLOAT3
+    float* get_normal_buffer()
+    {
+      return reinterpret_cast<float*>(mData + get_header().normalsoffset);
+    }
+
+    util::array_view<util::quadruple<float> const> get_points_view()
+    {
+      return {reinterpret_cast<util::quadruple<float> const*>(get_point_buffer()), get_num_points()};
+    }
+
+    util::triple<numeric_type> get_min() const
+    {
+      auto const& hh = get_header();
+      return {hh.min[0], hh.min[1], hh.min[2]};
+    }
+
+    util::triple<numeric_type> get_max() const
+    {
+      auto const& hh = get_header();
+      return {hh.max[0], hh.max[1], hh.max[2]};
+    }
+
+    numeric_type get_max_radius() const
+    {
+      return get_header().maxradius;
+    }
+
+    std::vector<util::quadruple<numeric_type> > get_points() override final
+    {
+      auto result = std::vector<util::quadruple<numeric_type> > {};
+      result.reserve(get_num_points());
+      auto buffer = get_point_buffer();
+      for (size_t idx = 0; idx < get_num_points(); ++idx) {
+        auto pp = buffer + 4 * idx;
+        result.push_back({pp[0], pp[1], pp[2], pp[3]});
+      }
+      return result;
+    }
+
+    std::vector<util::triple<numeric_type> > get_normals() override final
+    {
+      auto result = std::vector<util::triple<numeric_type> > {};
+      result.reserve(get_num_points());
+      auto buffer = get_normal_buffer();
+      for (size_t idx = 0; idx < get_num_points(); ++idx) {
+        auto nn = buffer + 3 * idx;
+        result.push_back({nn[0], nn[1], nn[2]});
+      }
+      return result;
+    }
+
+    std::string get_input_file_name() const override final
+    {
+      return mInfilename;
+    }
+
+  private:
+    rtipc_format::header const& get_header() const
+    {
+      return *reinterpret_cast<rtipc_format::header const*>(mData);
+    }
+
+    bool check_header() const
+    {
+      auto const& hh = get_header();
+      return
+        std::memcmp(hh.magic, rtipc_format::sMagic, sizeof(hh.magic)) == 0 &&
+        hh.version == rtipc_format::sVersion &&
+        hh.headersize == sizeof(rtipc_format::header) &&
+        hh.pointsoffset % rtipc_format::sAlignment == 0 &&
+        hh.normalsoffset % rtipc_format::sAlignment == 0 &&
+        hh.pointsoffset >= sizeof(rtipc_format::header) &&
+        hh.normalsoffset >= hh.pointsoffset + hh.numpoints * rtipc_format::sPointSize &&
+        rtipc_format::file_size(hh) <= mSize;
+    }
+
+    void unmap()
+    {
+      if (mData != nullptr) {
+        munmap(mData, mSize);
+        mData = nullptr;
+      }
+    }
+
+    std::string mInfilename;
+    char* mData = nullptr;
+    size_t mSize = 0;
+  };
+}} // namespace
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../trace/hit_accumulator.hpp"
+
+// The file format of a shard of a run (file extension .rtishard)
+//
+// A run may be split into shards which trace parts of the ray budget with
+// different random number streams, e.g., on different nodes of a cluster (see
+// the option --shard of rti). Every shard writes the raw sums of its
+// hit_accumulator into a file. Summing the files of all shards (see
+// rti-merge-shards) gives the same statistics as a single run.
+//
+// The file consists of a header followed by arrays of numprims elements each:
+// the hit counts (uint64), the sums S1, S2, S3, S4 (double), and the exposed
+// areas (double). All values are stored in the byte order of the machine
+// which wrote the file.
+
+namespace rti { namespace io {
+
+  class shard_format {
+  public:
+    static constexpr char sMagic[8] = {'R', 'T', 'I', 'S', 'H', 'A', 'R', 'D'};
+    static constexpr uint32_t sVersion = 1;
+
+    struct header {
+      char magic[8];
+      uint32_t version;
+      uint32_t headersize;
+      uint64_t numprims;
+      // The number of rays traced by this shard
+      uint64_t numrays;
+      // The total number of hits (see hit_accumulator::get_cnts_sum())
+      uint64_t totalcnts;
+      uint32_t shardindex;
+      uint32_t numshards;
+    };
+
+    // Writes the accumulator of shard pShardIndex out of pNumShards to
+    // pFilename. Returns false on failure.
+    template<typename numeric_type>
+    static
+    bool write(trace::hit_accumulator<numeric_type>& pAcc,
+               uint64_t pNumRays,
+               uint32_t pShardIndex,
+               uint32_t pNumShards,
+               std::string const& pFilename)
+    {
+      auto cnts = pAcc.get_cnts();
+      auto hh = header {};
+      std::memcpy(hh.magic, sMagic, sizeof(hh.magic));
+      hh.version = sVersion;
+      hh.headersize = sizeof(header);
+      hh.numprims = cnts.size();
+      hh.numrays = pNumRays;
+      hh.totalcnts = pAcc.get_cnts_sum();
+      hh.shardindex = pShardIndex;
+      hh.numshards = pNumShards;
+      auto areas = pAcc.get_exposed_areas();
+      if (areas.size() != hh.numprims) {
+        return false;
+      }
+      auto out = std::ofstream {pFilename, std::ios::binary | std::ios::trunc};
+      if ( ! out) {
+        return false;
+      }
+      out.write(reinterpret_cast<char const*>(&hh), sizeof(hh));
+      write_sums(out, pAcc);
+      return (bool) out;
+    }
+
+    // Reads a shard file. Returns nullptr if the file cannot be read or is
+    // not a shard file of this version.
+    template<typename numeric_type>
+    static
+    std::unique_ptr<trace::hit_accumulator<numeric_type> >
+    read(std::string const& pFilename, header& pHeader)
+    {
+      auto in = std::ifstream {pFilename, std::ios::binary};
+      if ( ! in) {
+        return nullptr;
+      }
+      in.read(reinterpret_cast<char*>(&pHeader), sizeof(pHeader));
+      if ( ! in ||
+           std::memcmp(pHeader.magic, sMagic, sizeof(pHeader.magic)) != 0 ||
+           pHeader.version != sVersion ||
+           pHeader.headersize != sizeof(header)) {
+        return nullptr;
+      }
+      return read_sums<numeric_type>(in, pHeader.numprims, pHeader.totalcnts);
+    }
+
+    // Writes the arrays of the accumulator (the layout after the header);
+    // also used by io::checkpoint_format.
+    template<typename numeric_type>
+    static
+    void write_sums(std::ofstream& pOut, trace::hit_accumulator<numeric_type>& pAcc)
+    {
+      write_array<uint64_t>(pOut, pAcc.get_cnts());
+      write_array<double>(pOut, pAcc.get_s1s());
+      write_array<double>(pOut, pAcc.get_s2s());
+      write_array<double>(pOut, pAcc.get_s3s());
+      write_array<double>(pOut, pAcc.get_s4s());
+      write_array<double>(pOut, pAcc.get_exposed_areas());
+    }
+
+    // Reads the arrays written by write_sums(). Returns nullptr on failure.
+    template<typename numeric_type>
+    static
+    std::unique_ptr<trace::hit_accumulator<numeric_type> >
+    read_sums(std::ifstream& pIn, uint64_t pNumPrims, uint64_t pTotalCnts)
+    {
+      auto cnts = read_array<uint64_t, size_t>(pIn, pNumPrims);
+      auto s1s = read_array<double, double>(pIn, pNumPrims);
+      auto s2s = read_array<double, double>(pIn, pNumPrims);
+      auto s3s = read_array<double, double>(pIn, pNumPrims);
+      auto s4s = read_array<double, double>(pIn, pNumPrims);
+      auto areas = read_array<double, numeric_type>(pIn, pNumPrims);
+      if ( ! pIn) {
+        return nullptr;
+      }
+      return std::make_unique<trace::hit_accumulator<numeric_type> >
+        (std::move(cnts), pTotalCnts, std::move(areas),
+         std::move(s1s), std::move(s2s), std::move(s3s), std::move(s4s));
+    }
+
+  private:
+    template<typename file_type, typename value_type>
+    static
+    void write_array(std::ofstream& pOut, std::vector<value_type> const& pValues)
+    {
+      if constexpr (std::is_same<file_type, value_type>::value) {
+        pOut.write(reinterpret_cast<char const*>(pValues.data()), pValues.size() * sizeof(file_type));
+      } else {
+        auto converted = std::vector<file_type> (pValues.begin(), pValues.end());
+        pOut.write(reinterpret_cast<char const*>(converted.data()), converted.size() * sizeof(file_type));
+      }
+    }
+
+    template<typename file_type, typename value_type>
+    static
+    std::vector<value_type> read_array(std::ifstream& pIn, uint64_t pSize)
+    {
+      auto values = std::vector<file_type> (pSize);
+      pIn.read(reinterpret_cast<char*>(values.data()), pSize * sizeof(file_type));
+      if constexpr (std::is_same<file_type, value_type>::value) {
+        return values;
+      } else {
+        return std::vector<value_type> (values.begin(), values.end());
+      }
+    }
+  };
+}} // namespace
@@ -0,0 +1,103 @@
+#pragma once
+
+// Writes intermediate results of a trace (see tracer::set_snapshots()) to
+// .vtp files on a background thread.
+//
+// The tracing thread which takes a snapshot only hands it over (submit()).
+// If the writer is still busy with an older snapshot when a new one arrives,
+// the pending one is replaced; hence, the tracer never waits for the file
+// system. The snapshots are written to <base>.snapshot.<k>.vtp, which
+// Paraview opens as a time series.
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vtp_writer.hpp"
+#include "../geo/point_cloud_disc_geometry.hpp"
+#include "../trace/hit_accumulator.hpp"
+#include "../util/logger.hpp"
+
+namespace rti { namespace io {
+
+  template<typename Ty>
+  class snapshot_writer {
+  public:
+    snapshot_writer(rti::geo::point_cloud_disc_geometry<Ty>& pGeometry,
+                    std::string pBaseFilename,
+                    vtp_write_options pOptions = {}) :
+      mGeometry(pGeometry),
+      mBaseFilename(std::move(pBaseFilename)),
+      mOptions(pOptions),
+      mThread([this] { write_loop(); }) {}
+
+    // Writes the pending snapshot (if any) before it returns
+    ~snapshot_writer()
+    {
+      {
+        auto lock = std::lock_guard<std::mutex> {mMutex};
+        mStop = true;
+      }
+      mCondition.notify_one();
+      mThread.join();
+    }
+
+    snapshot_writer(snapshot_writer const&) = delete;
+    snapshot_writer& operator=(snapshot_writer const&) = delete;
+
+    // pNumRays is the number of rays contained in the snapshot
+    void submit(std::unique_ptr<rti::trace::hit_accumulator<Ty> > pSnapshot, size_t pNumRays)
+    {
+      {
+        auto lock = std::lock_guard<std::mutex> {mMutex};
+        mPending = std::move(pSnapshot);
+        mPendingNumRays = pNumRays;
+      }
+      mCondition.notify_one();
+    }
+
+    // The number of snapshots written so far
+    size_t get_num_written()
+    {
+      auto lock = std::lock_guard<std::mutex> {mMutex};
+      return mNumWritten;
+    }
+
+  private:
+    void write_loop()
+    {
+      auto lock = std::unique_lock<std::mutex> {mMutex};
+      while (true) {
+        mCondition.wait(lock, [this] { return mPending != nullptr || mStop; });
+        if (mPending == nullptr) {
+          return; // stopped
+        }
+        auto snapshot = std::move(mPending);
+        auto numrays = mPendingNumRays;
+        auto filename = mBaseFilename + ".snapshot." + std::to_string(mNumWritten) + ".vtp";
+        lock.unlock();
+        auto metadata = std::vector<rti::util::pair<std::string> >
+          {{"snapshot-rays", std::to_string(numrays)}};
+        vtp_writer<Ty>::write(mGeometry, *snapshot, filename, metadata, mOptions);
+        RLOG_INFO << "Snapshot of " << numrays << " rays written to " << filename << std::endl;
+        lock.lock();
+        mNumWritten += 1;
+      }
+    }
+
+    rti::geo::point_cloud_disc_geometry<Ty>& mGeometry;
+    std::string mBaseFilename;
+    vtp_write_options mOptions;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::unique_ptr<rti::trace::hit_accumulator<Ty> > mPending;
+    size_t mPendingNumRays = 0;
+    size_t mNumWritten = 0;
+    bool mStop = false;
+    // Last member; started after all the other members are initialized
+    std::thread mThread;
+  };
+}} // namespace
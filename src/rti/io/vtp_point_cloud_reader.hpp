@@ -13,10 +13,14 @@
 #include <vtkXMLPolyDataReader.h>
 
 #include "i_point_cloud_reader.hpp"
+#include "point_cloud_buffers.hpp"
 #include "../util/utils.hpp"
 
 namespace rti { namespace io {
   // The parameter numeric_type is intended to be instantiated as a numeric type.
+  //
+  // The reader stores the point cloud in single precision (as Embree does) in
+  // Embree compatible buffers (see get_buffers()).
   template<typename numeric_type>
   class vtp_point_cloud_reader : public rti::io::i_point_cloud_reader<numeric_type> {
   public:
@@ -67,6 +71,7 @@ namespace rti { namespace io {
           << "Warning: " << typeid(this).name()
           << " could not find surface normal data in the file " << pFilename << std::endl;
       }
+      mBuffers.reserve(numPnts);
       for (vtkIdType idx = 0; idx < numPnts; ++idx) {
         double xyz[3]; // 3 dimensions
         polydata->GetPoint(idx, xyz);
@@ -80,28 +85,41 @@ namespace rti { namespace io {
           radius[0] *= std::sqrt(3.0)/2 * (1 + radiusEpsilon);
         }
         rti::util::quadruple<numeric_type> point {(numeric_type) xyz[0], (numeric_type) xyz[1] , (numeric_type) xyz[2], (numeric_type) radius[0]};
-        mPoints.push_back(point);
         double nxnynz[3];
         normals->GetTuple(idx, nxnynz);
         rti::util::triple<numeric_type> normal {(numeric_type) nxnynz[0], (numeric_type) nxnynz[1], (numeric_type) nxnynz[2]};
         // Normalize
         if ( ! rti::util::is_normalized(normal))
           rti::util::normalize(normal);
-        mNormals.push_back(normal);
+        mBuffers.push_back(point, normal);
       }
-      // Shrink memory
-      mPoints.shrink_to_fit();
-      mNormals.shrink_to_fit();
     }
 
     ~vtp_point_cloud_reader() {}
 
+    // Copies the points; prefer get_buffers()
     std::vector<rti::util::quadruple<numeric_type> > get_points() override final {
-      return mPoints;
+      auto result = std::vector<rti::util::quadruple<numeric_type> > {};
+      result.reserve(mBuffers.get_num_points());
+      for (auto const& pp : mBuffers.get_points_view()) {
+        result.push_back({pp[0], pp[1], pp[2], pp[3]});
+      }
+      return result;
     }
 
+    // Copies the normals; prefer get_buffers()
     std::vector<rti::util::triple<numeric_type> > get_normals() override final {
-      return mNormals;
+      auto result = std::vector<rti::util::triple<numeric_type> > {};
+      result.reserve(mBuffers.get_num_points());
+      for (auto const& nn : mBuffers.get_normals_view()) {
+        result.push_back({nn[0], nn[1], nn[2]});
+      }
+      return result;
+    }
+
+    // A geometry may borrow these buffers instead of copying the point cloud
+    point_cloud_buffers& get_buffers() {
+      return mBuffers;
     }
 
     std::string get_input_file_name() const override final {
@@ -109,7 +127,6 @@ namespace rti { namespace io {
     }
   private:
     std::string mInfilename;
-    std::vector<rti::util::quadruple<numeric_type> > mPoints;
-    std::vector<rti::util::triple<numeric_type> > mNormals;
+    point_cloud_buffers mBuffers;
   };
 }} // namespace rti
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include <vtkCellArray.h>
 #include <vtkCellData.h>
 #include <vtkDoubleArray.h>
@@ -19,6 +21,49 @@
 #include "../trace/i_hit_accumulator.hpp"
 
 namespace rti { namespace io {
+
+  // Selects how vtp_writer encodes the data arrays.
+  //
+  // ASCII writes human readable XML. BINARY writes base64 encoded (and
+  // optionally compressed) arrays inline. APPENDED writes raw (optionally
+  // compressed) arrays at the end of the file, which is the smallest and
+  // fastest to read and write. AUTO uses ASCII for small outputs and BINARY
+  // for outputs with at least sAutoBinaryCells cells.
+  class vtp_write_options {
+  public:
+    enum class format_type { AUTO, ASCII, BINARY, APPENDED };
+    enum class compression_type { NONE, ZLIB, LZ4 };
+
+    format_type format = format_type::AUTO;
+    // Ignored for ASCII output
+    compression_type compression = compression_type::ZLIB;
+
+    static constexpr long long sAutoBinaryCells = 100 * 1000;
+
+    // Returns false if the name is unknown; then pFormat remains unchanged.
+    static
+    bool parse_format(std::string const& pName, format_type& pFormat)
+    {
+      if (pName == "auto") pFormat = format_type::AUTO;
+      else if (pName == "ascii") pFormat = format_type::ASCII;
+      else if (pName == "binary") pFormat = format_type::BINARY;
+      else if (pName == "appended") pFormat = format_type::APPENDED;
+      else return false;
+      return true;
+    }
+
+    // Returns false if the name is unknown; then pCompression remains unchanged.
+    static
+    bool parse_compression(std::string const& pName, compression_type& pCompression)
+    {
+      if (pName == "none") pCompression = compression_type::NONE;
+      else if (pName == "zlib") pCompression = compression_type::ZLIB;
+      else if (pName == "lz4") pCompression = compression_type::LZ4;
+      else return false;
+      return true;
+    }
+  };
+
   template<typename Ty>
   class vtp_writer {
   public:
@@ -27,7 +72,8 @@ namespace rti { namespace io {
     void write(rti::geo::point_cloud_disc_geometry<Ty>& pGeometry,
                rti::trace::i_hit_accumulator<Ty>& pHA,
                std::string pOutfilename,
-               std::vector<rti::util::pair<std::string> > pMetadata) {
+               std::vector<rti::util::pair<std::string> > pMetadata,
+               vtp_write_options pOptions = {}) {
       // Precondition:
       assert (pGeometry.get_num_primitives() == pHA.get_values().size() &&
               "hit count accumulator does not fit the given geometry");
@@ -37,14 +83,15 @@ namespace rti { namespace io {
       try_add_hit_counts_to_points(polydata, pHA);
       try_add_statistical_data(polydata, pHA);
       add_metadata(polydata, pMetadata);
-      write(polydata, pOutfilename);
+      write(polydata, pOutfilename, pOptions);
     }
     
     static
     void write(rti::geo::absc_point_cloud_geometry<Ty>& pGeometry,
                rti::trace::i_hit_accumulator<Ty>& pHA,
                std::string pOutfilename,
-               std::vector<rti::util::pair<std::string> > pMetadata) {
+               std::vector<rti::util::pair<std::string> > pMetadata,
+               vtp_write_options pOptions = {}) {
       // Precondition:
       assert (pGeometry.get_num_primitives() == pHA.get_values().size() &&
               "hit count accumulator does not fit the given geometry");
@@ -54,14 +101,15 @@ namespace rti { namespace io {
       try_add_hit_counts_to_points(polydata, pHA);
       try_add_statistical_data(polydata, pHA);
       add_metadata(polydata, pMetadata);
-      write(polydata, pOutfilename);
+      write(polydata, pOutfilename, pOptions);
     }
 
     static
     void write(rti::geo::triangle_geometry<Ty>& pGeometry,
                rti::trace::i_hit_accumulator<Ty>& pHA,
                std::string pOutfilename,
-               std::vector<rti::util::pair<std::string> > pMetadata) {
+               std::vector<rti::util::pair<std::string> > pMetadata,
+               vtp_write_options pOptions = {}) {
       // Precondition:
       assert (pGeometry.get_num_primitives() == pHA.get_values().size() &&
               "hit count accumulator does not fit the given geometry");
@@ -71,38 +119,65 @@ namespace rti { namespace io {
       try_add_hit_counts_to_triangles(polydata, pHA);
       try_add_statistical_data(polydata, pHA);
       add_metadata(polydata, pMetadata);
-      write(polydata, pOutfilename);
+      write(polydata, pOutfilename, pOptions);
     }
 
     static
     void write(rti::geo::absc_boundary<Ty>& pBoundary,
-               std::string pOutfilename) {
+               std::string pOutfilename,
+               vtp_write_options pOptions = {}) {
       auto polydata = get_polydata(pBoundary);
-      write(polydata, pOutfilename);
+      write(polydata, pOutfilename, pOptions);
     }
 
     static
     void write(std::vector<rti::util::pair<rti::util::triple<Ty> > >* pVec,
                std::string pOutfilename) {
       auto polydata = get_polydata(*pVec);
-      write(polydata, pOutfilename);
+      write(polydata, pOutfilename, {});
     }
 
     static
     void write(std::vector<rti::util::triple<Ty> >* pVec,
                std::string pOutfilename) {
       auto polydata = get_polydata(*pVec);
-      write(polydata, pOutfilename);
+      write(polydata, pOutfilename, {});
     }
 
   private:
 
     static
-    void write(vtkSmartPointer<vtkPolyData> pPolydata, std::string pOutfilename) {
+    void write(vtkSmartPointer<vtkPolyData> pPolydata, std::string pOutfilename,
+               vtp_write_options const& pOptions) {
       auto writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
       writer->SetFileName(pOutfilename.c_str());
       writer->SetInputData(pPolydata);
-      writer->SetDataModeToAscii(); // human readable XML output
+      using format = vtp_write_options::format_type;
+      auto fmt = pOptions.format;
+      if (fmt == format::AUTO) {
+        fmt = pPolydata->GetNumberOfCells() < vtp_write_options::sAutoBinaryCells ? format::ASCII : format::BINARY;
+      }
+      switch (fmt) {
+      case format::BINARY:
+        writer->SetDataModeToBinary();
+        break;
+      case format::APPENDED:
+        writer->SetDataModeToAppended();
+        writer->EncodeAppendedDataOff(); // raw instead of base64
+        break;
+      default:
+        writer->SetDataModeToAscii(); // human readable XML output
+        break;
+      }
+      if (fmt != format::ASCII) {
+        // 32 bit block headers limit the size of a single array
+        writer->SetHeaderTypeToUInt64();
+        switch (pOptions.compression) {
+        case vtp_write_options::compression_type::ZLIB: writer->SetCompressorTypeToZLib(); break;
+        case vtp_write_options::compression_type::LZ4: writer->SetCompressorTypeToLZ4(); break;
+        default: writer->SetCompressorTypeToNone(); break;
+        }
+      }
       writer->Write();
     }
 
@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <omp.h>
+#include <string>
+#include <vector>
+
+#include <embree3/rtcore.h>
+#include <pmmintrin.h> // SSE3
+#include <xmmintrin.h> // SSE
+
+#include "../geo/boundary_x_y.hpp"
+#include "../geo/point_cloud_disc_geometry.hpp"
+#include "../io/batch_manifest.hpp"
+#include "../io/rtipc_point_cloud_reader.hpp"
+#include "../io/vtp_point_cloud_reader.hpp"
+#include "../io/vtp_writer.hpp"
+#include "../particle/i_particle.hpp"
+#include "../ray/cosine_direction_z.hpp"
+#include "../ray/rectangle_origin_z.hpp"
+#include "../ray/source.hpp"
+#include "../reflection/diffuse.hpp"
+#include "../trace/result.hpp"
+#include "../trace/tracer.hpp"
+#include "../util/clo.hpp"
+#include "../util/logger.hpp"
+#include "../util/timer.hpp"
+#include "../util/timing.hpp"
+
+// Runs the jobs of a manifest (see io::batch_manifest) in one process.
+//
+// In contrast to launching rti once per input, the Embree device and the
+// OpenMP threads are created once and stay alive for all the jobs. The runs
+// are pipelined: while the main thread traces job i, a background thread
+// reads job i + 1 and puts it into Embree, and another one writes the results
+// of job i - 1. The geometry and the source are set up like in rti (discs,
+// periodic boundary, cosine source above the structure).
+
+namespace rti {
+  namespace main {
+
+    using numeric_type = float;
+
+    // An input which has been read and put into Embree. It is shared by the
+    // trace of its job and the writes of the results.
+    struct batch_input {
+      std::unique_ptr<io::rtipc_point_cloud_reader<numeric_type> > rtipcreader;
+      std::unique_ptr<io::vtp_point_cloud_reader<numeric_type> > vtpreader;
+      std::unique_ptr<geo::point_cloud_disc_geometry<numeric_type> > geometry;
+      util::pair<util::triple<numeric_type> > bdbox;
+      std::unique_ptr<geo::boundary_x_y<numeric_type> > boundary;
+      util::timing_record timing {"read"};
+    };
+
+    // Reads the input file of a job; returns nullptr if it cannot be read.
+    // Called on a background thread; the Embree API is thread safe as long
+    // as no two threads modify the same object.
+    std::shared_ptr<batch_input> load_input(RTCDevice& pDevice, std::string const& pInfilename)
+    {
+      auto input = std::make_shared<batch_input>();
+      auto timer = util::timer {};
+      // The native binary format is memory mapped; other inputs are parsed as .vtp.
+      if (vtksys::SystemTools::GetFilenameLastExtension(pInfilename) == ".rtipc") {
+        input->rtipcreader = std::make_unique<io::rtipc_point_cloud_reader<numeric_type> >(pInfilename);
+        if ( ! input->rtipcreader->is_valid()) {
+          return nullptr;
+        }
+        input->geometry = std::make_unique<geo::point_cloud_disc_geometry<numeric_type> >
+          (pDevice, *input->rtipcreader);
+      } else {
+        input->vtpreader = std::make_unique<io::vtp_point_cloud_reader<numeric_type> >(pInfilename);
+        input->geometry = std::make_unique<geo::point_cloud_disc_geometry<numeric_type> >
+          (pDevice, input->vtpreader->get_buffers());
+      }
+      if (input->geometry->get_num_primitives() == 0) {
+        return nullptr;
+      }
+      input->bdbox = input->geometry->get_bounding_box();
+      input->boundary = std::make_unique<geo::boundary_x_y<numeric_type> >
+        (pDevice, input->bdbox, geo::bound_condition::PERIODIC, geo::bound_condition::PERIODIC);
+      input->timing.add_nanoseconds(timer.elapsed_nanoseconds());
+      return input;
+    }
+
+    // The sticking coefficient of the current job. It is set by the main
+    // thread between two runs; a local class cannot capture it.
+    numeric_type stickingStatic = 0.8f;
+
+    class particle_t : public particle::i_particle<numeric_type> {
+    public:
+      numeric_type
+      get_sticking_probability
+      (RTCRay& rayin,
+       RTCHit& hitin,
+       geo::meta_geometry<numeric_type>& geometry,
+       rng::i_rng& rng,
+       rng::i_rng::i_state& rngstate) override final {
+        return stickingStatic;
+      }
+
+      void init_new() override final {}
+    };
+  }
+}
+
+int main(int argc, char* argv[]) {
+  using namespace rti;
+  using numeric_type = main::numeric_type;
+  using tracer_type = trace::tracer<numeric_type, main::particle_t, reflection::diffuse<numeric_type> >;
+
+  auto optMan = std::make_unique<util::clo::manager>();
+  optMan->addCmlParam(util::clo::string_option
+    {"MANIFEST", {"--manifest"},
+     "specifies the path of the manifest; every line holds an input file, an output file and "
+     "optional parameters key=value (sticking-coefficient, number-of-rays, time-budget, repetitions)",
+     true});
+  optMan->addCmlParam(util::clo::string_option
+    {"MAX_THREADS", {"--max-threads", "-m"}, "specifies the maximum number of threads used", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"STICKING_COEFFICIENT", {"--sticking-coefficient", "--sticking-c", "--sticking", "-s"},
+     "specifies the sticking coefficient of jobs which do not give one (default: 0.8)", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"NUM_RAYS", {"--number-of-rays", "--n-rays", "-r"},
+     "specifies the number of rays of jobs which do not give one (default: 131072)", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"TIME_BUDGET", {"--time-budget"},
+     "stops every run after the given number of seconds unless the job gives a time budget", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"OUTPUT_FORMAT", {"--output-format"},
+     "specifies the encoding of the output files out of ascii, binary, appended, auto", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"OUTPUT_COMPRESSION", {"--output-compression"},
+     "specifies the compression of binary output out of none, zlib, lz4", false});
+  optMan->addCmlParam(util::clo::bool_option
+    {"ANALYTIC_BOUNDARY", {"--analytic-boundary"},
+     "handles the boundary in closed form instead of tracing boundary triangles"});
+  optMan->addCmlParam(util::clo::bool_option
+    {"BACK_FACE_FILTER", {"--back-face-filter"},
+     "rejects back face hits in an Embree filter function instead of retracing them"});
+  optMan->addCmlParam(util::clo::string_option
+    {"MULTI_HIT", {"--multi-hit"},
+     "engine which finds overlapping discs hit by a ray: neighborhood (default) or filter", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"LOG_LEVEL", {"--log-level"},
+     "comma separated log levels out of trace, debug, info, warning, error, progress, all, none", false});
+  if ( ! optMan->parse_args(argc, argv)) {
+    std::cout << optMan->get_usage_msg();
+    exit(EXIT_FAILURE);
+  }
+  auto loglevels = optMan->get_string_option_value("LOG_LEVEL");
+  if ( ! loglevels.empty() && ! util::logger::set_levels(loglevels)) {
+    std::cout << "Warning: unknown log level in \"" << loglevels << "\"; using defaults." << std::endl;
+  }
+  auto maxThreadsStr = optMan->get_string_option_value("MAX_THREADS");
+  if ( ! maxThreadsStr.empty()) {
+    auto maxThreads = std::stoi(maxThreadsStr);
+    if (maxThreads < omp_get_max_threads()) {
+      omp_set_num_threads(maxThreads);
+    }
+  }
+  std::cout << "Maximum number of threads used == " << omp_get_max_threads() << std::endl;
+  // Flush-to-Zero and Denormals-are-Zero for the threads of the OpenMP team
+  // (see rti). The team is reused by all the runs of the batch.
+  #pragma omp parallel
+  {
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+  }
+
+  auto defaults = io::batch_job {};
+  try {
+    defaults.stickingC = std::stof(optMan->get_string_option_value("STICKING_COEFFICIENT"));
+  } catch (...) {}
+  if ( ! (0 < defaults.stickingC && defaults.stickingC <= 1)) {
+    std::cout << "Warning: sticking coefficient has been reset to sane value." << std::endl;
+    defaults.stickingC = 1.0f;
+  }
+  try {
+    defaults.numRays = std::stoull(optMan->get_string_option_value("NUM_RAYS"));
+  } catch (...) {}
+  try {
+    defaults.timeBudget = std::stod(optMan->get_string_option_value("TIME_BUDGET"));
+  } catch (...) {}
+  auto jobs = std::vector<io::batch_job> {};
+  auto error = std::string {};
+  if ( ! io::batch_manifest::read(optMan->get_string_option_value("MANIFEST"), defaults, jobs, error)) {
+    std::cerr << "Error: invalid manifest: " << error << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Running " << jobs.size() << " jobs" << std::endl;
+  auto writeoptions = io::vtp_write_options {};
+  auto formatstr = optMan->get_string_option_value("OUTPUT_FORMAT");
+  if ( ! formatstr.empty() && ! io::vtp_write_options::parse_format(formatstr, writeoptions.format)) {
+    std::cout << "Warning: unknown output format \"" << formatstr << "\"; using auto." << std::endl;
+  }
+  auto compressionstr = optMan->get_string_option_value("OUTPUT_COMPRESSION");
+  if ( ! compressionstr.empty() &&
+       ! io::vtp_write_options::parse_compression(compressionstr, writeoptions.compression)) {
+    std::cout << "Warning: unknown output compression \"" << compressionstr << "\"; using zlib." << std::endl;
+  }
+  auto multihit = tracer_type::multi_hit_engine::NEIGHBORHOOD;
+  auto enginestr = optMan->get_string_option_value("MULTI_HIT");
+  if ( ! enginestr.empty() && ! tracer_type::parse_multi_hit_engine(enginestr, multihit)) {
+    std::cout << "Warning: unknown multi-hit engine \"" << enginestr << "\"; using neighborhood." << std::endl;
+  }
+
+  // One device for all the jobs
+  auto device = rtcNewDevice("hugepages=1");
+  auto timing = util::timing_record {"batch"};
+  auto totaltimer = util::timer {};
+  auto numfailed = 0u;
+  auto numruns = 0u;
+  auto load = [&device](std::string pInfilename) {
+    return main::load_input(device, pInfilename);
+  };
+  // At most one write is in flight; it overlaps with the next trace.
+  auto pendingwrite = std::future<void> {};
+  auto wait_for_write = [&pendingwrite, &timing, &numfailed]() {
+    if ( ! pendingwrite.valid()) {
+      return;
+    }
+    auto waitprobe = util::timing_probe {timing.child("wait-for-write")};
+    try {
+      pendingwrite.get();
+    } catch (std::exception const& ee) {
+      std::cerr << "Error: writing failed: " << ee.what() << std::endl;
+      numfailed += 1;
+    }
+  };
+  auto nextinput = jobs.empty()
+    ? std::future<std::shared_ptr<main::batch_input> > {}
+    : std::async(std::launch::async, load, jobs.front().infile);
+  for (size_t idx = 0; idx < jobs.size(); ++idx) {
+    auto const& job = jobs[idx];
+    auto waitprobe = util::timing_probe {timing.child("wait-for-input")};
+    auto input = nextinput.get();
+    waitprobe.stop();
+    // Prefetch the next input while tracing this one
+    if (idx + 1 < jobs.size()) {
+      nextinput = std::async(std::launch::async, load, jobs[idx + 1].infile);
+    }
+    if (input == nullptr) {
+      std::cerr << "Error: cannot read " << job.infile << "; skipping the job" << std::endl;
+      numfailed += 1;
+      continue;
+    }
+    timing.merge(input->timing);
+
+    auto zmax = std::max(input->bdbox[0][2], input->bdbox[1][2]);
+    auto origin = ray::rectangle_origin_z<numeric_type>
+      {zmax, {input->bdbox[0][0], input->bdbox[0][1]}, {input->bdbox[1][0], input->bdbox[1][1]}};
+    auto direction = ray::cosine_direction_z<numeric_type> {};
+    auto source = ray::source<numeric_type> {origin, direction};
+    auto numrays = job.numRays;
+    if (numrays == 0) {
+      numrays = job.timeBudget > 0
+        ? std::numeric_limits<decltype(numrays)>::max()
+        : 128 * 1024ull; // default value of rti
+    }
+    main::stickingStatic = job.stickingC;
+    // The repetitions trace the same scene (BVH and exposed areas)
+    auto tracer = tracer_type {*input->geometry, *input->boundary, source, numrays};
+    tracer.set_analytic_boundary(optMan->get_bool_option_value("ANALYTIC_BOUNDARY"));
+    tracer.set_back_face_filter(optMan->get_bool_option_value("BACK_FACE_FILTER"));
+    tracer.set_multi_hit_engine(multihit);
+    tracer.set_time_budget(job.timeBudget);
+    tracer.set_keep_scene(true);
+    for (auto rep = 0u; rep < job.repetitions; ++rep) {
+      tracer.set_rng_stream(rep);
+      auto traceprobe = util::timing_probe {timing.child("trace")};
+      auto result = tracer.run();
+      traceprobe.stop();
+      numruns += 1;
+      util::logger::flush();
+      std::cout << result;
+
+      auto outfilename = io::batch_manifest::get_outfile(job, rep);
+      auto metadata = std::vector<util::pair<std::string> >
+        {{"running-time[ns]", std::to_string(result.timeNanoseconds)},
+         {"number-of-rays", std::to_string(result.numRays)},
+         {"sticking-coefficient", std::to_string(job.stickingC)},
+         {"input-file", job.infile},
+         {"repetition", std::to_string(rep)}};
+      for (auto const& entry : result.timing.flatten()) {
+        metadata.push_back(entry);
+      }
+      // The previous write must be done before the next one starts; the
+      // writes of a job keep its input alive.
+      wait_for_write();
+      pendingwrite = std::async
+        (std::launch::async,
+         [input, outfilename, metadata, writeoptions]
+         (std::unique_ptr<trace::i_hit_accumulator<numeric_type> > pAcc) {
+          io::vtp_writer<numeric_type>::write
+            (*input->geometry, *pAcc, outfilename, metadata, writeoptions);
+          std::cout << "Output written to " << outfilename << std::endl;
+        },
+         std::move(result.hitAccumulator));
+    }
+  }
+  wait_for_write();
+  timing.add_nanoseconds(totaltimer.elapsed_nanoseconds());
+  std::cout
+    << numruns << " runs of " << jobs.size() << " jobs in "
+    << timing.get_nanoseconds() * 1e-9 << " seconds" << std::endl;
+  timing.print(std::cout);
+  rtcReleaseDevice(device);
+  if (numfailed > 0) {
+    std::cerr << numfailed << " jobs or writes failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../io/rtipc_format.hpp"
+#include "../io/vtp_point_cloud_reader.hpp"
+#include "../io/xaver/vtu_point_cloud_reader.hpp"
+#include "../util/clo.hpp"
+#include "../util/timer.hpp"
+
+// Converts a point cloud given as .vtp or .vtu file into the native binary
+// format of rti (.rtipc). The converted file can be memory mapped by rti
+// without parsing.
+
+int main(int argc, char* argv[]) {
+  using namespace rti;
+  using numeric_type = float;
+  auto optMan = std::make_unique<util::clo::manager>();
+  optMan->addCmlParam(util::clo::string_option
+    {"INPUT_FILE", {"--infile", "-i"}, "specifies the path of the input file (.vtp or .vtu)", true});
+  optMan->addCmlParam(util::clo::string_option
+    {"OUTPUT_FILE", {"--outfile", "-o"},
+     "specifies the path of the output file (default: the input file with the extension .rtipc)", false});
+  if ( ! optMan->parse_args(argc, argv)) {
+    std::cout << optMan->get_usage_msg();
+    exit(EXIT_FAILURE);
+  }
+  auto infilename = optMan->get_string_option_value("INPUT_FILE");
+  auto outfilename = optMan->get_string_option_value("OUTPUT_FILE");
+  if (outfilename.empty()) {
+    auto path = vtksys::SystemTools::GetFilenamePath(infilename);
+    if ( ! path.empty()) {
+      path.append("/");
+    }
+    outfilename = path + vtksys::SystemTools::GetFilenameWithoutExtension(infilename) + ".rtipc";
+  }
+
+  auto timer = util::timer {};
+  auto reader = std::unique_ptr<io::i_point_cloud_reader<numeric_type> > {};
+  if (vtksys::SystemTools::GetFilenameLastExtension(infilename) == ".vtu") {
+    reader = std::make_unique<io::xaver::vtu_point_cloud_reader<numeric_type> >(infilename);
+  } else {
+    reader = std::make_unique<io::vtp_point_cloud_reader<numeric_type> >(infilename);
+  }
+  auto points = reader->get_points();
+  auto normals = reader->get_normals();
+  std::cout
+    << "Read " << points.size() << " points from " << infilename
+    << " in " << timer.elapsed_seconds() << " seconds" << std::endl;
+  if ( ! io::rtipc_format::write<numeric_type>(points, normals, outfilename)) {
+    std::cerr << "Error: could not write " << outfilename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Wrote " << outfilename << std::endl;
+  return EXIT_SUCCESS;
+}
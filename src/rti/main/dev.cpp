@@ -1,8 +1,11 @@
 #include <algorithm>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <omp.h>
+#include <sstream>
 #include <string>
+#include <unordered_set>
 
 #include <assert.h>
 
@@ -22,6 +25,9 @@
 #include "../geo/point_cloud_sphere_geometry.hpp"
 #include "../geo/triangle_factory.hpp"
 #include "../geo/triangle_geometry.hpp"
+#include "../io/rtipc_point_cloud_reader.hpp"
+#include "../io/shard_format.hpp"
+#include "../io/snapshot_writer.hpp"
 #include "../io/vtp_point_cloud_reader.hpp"
 #include "../io/christoph/vtu_point_cloud_reader.hpp"
 #include "../io/christoph/vtu_triangle_reader.hpp"
@@ -38,10 +44,14 @@
 #include "../reflection/diffuse.hpp"
 #include "../trace/point_cloud_context_simplified.hpp"
 #include "../trace/tracer.hpp"
+#ifdef RTI_USE_MPI
+#include "../trace/mpi_reducer.hpp"
+#endif
 #include "../trace/triangle_context_simplified.hpp"
 #include "../trace/result.hpp"
 #include "../util/clo.hpp"
 #include "../util/logger.hpp"
+#include "../util/timing.hpp"
 #include "../util/ray_logger.hpp"
 #include "../util/utils.hpp"
 
@@ -58,8 +68,19 @@ namespace rti {
       // We might want the output file to be mandatory in the future
       optMan->addCmlParam(rti::util::clo::string_option
         {"OUTPUT_FILE", {"--outfile", "-o"}, "specifies the path of the output file", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"OUTPUT_FORMAT", {"--output-format"},
+         "specifies the encoding of the output file out of ascii, binary, appended, auto "
+         "(default: auto, i.e., binary for large outputs)", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"OUTPUT_COMPRESSION", {"--output-compression"},
+         "specifies the compression of binary output out of none, zlib, lz4 (default: zlib)", false});
       optMan->addCmlParam(rti::util::clo::string_option
         {"NUM_RAYS", {"--number-of-rays", "--n-rays", "-r"}, "specifies the number of rays to use", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"TIME_BUDGET", {"--time-budget"},
+         "stops tracing after the given number of seconds; without --number-of-rays the number "
+         "of rays is limited by the time budget only", false});
       optMan->addCmlParam(rti::util::clo::bool_option
         {"TRIANGLES", {"--triangles"}, "sets triangles as surface primitives"});
       optMan->addCmlParam(rti::util::clo::bool_option
@@ -69,12 +90,69 @@ namespace rti {
          "specifies the sticking coefficient of the surface", false});
       optMan->addCmlParam(rti::util::clo::bool_option
         {"SINGLE_HIT", {"--single-hit", "--single"}, "sets single-hit intersections for the ray tracer"});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"RAY_LOG", {"--ray-log"}, "specifies the path of a binary ray log (enables ray logging)", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"RAY_LOG_EVERY", {"--ray-log-every"}, "log only every k-th ray (default: 1)", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"RAY_LOG_PRIMS", {"--ray-log-prims"},
+         "log only rays which hit one of the given comma separated primitive IDs", false});
+      optMan->addCmlParam(rti::util::clo::bool_option
+        {"ANALYTIC_BOUNDARY", {"--analytic-boundary"},
+         "handles the boundary in closed form instead of tracing boundary triangles"});
+      optMan->addCmlParam(rti::util::clo::bool_option
+        {"BACK_FACE_FILTER", {"--back-face-filter"},
+         "rejects back face hits in an Embree filter function instead of retracing them"});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"MULTI_HIT", {"--multi-hit"},
+         "engine which finds overlapping discs hit by a ray: neighborhood (default) or filter", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"SHARD", {"--shard"},
+         "traces shard i out of n (given as i/n) of the rays with its own random number stream and "
+         "writes the raw sums to the output file (.rtishard; merge the shards with rti-merge-shards)",
+         false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"CHECKPOINT", {"--checkpoint"},
+         "specifies the path of a checkpoint file which is written periodically during the trace "
+         "(.rtickpt; see --checkpoint-every and --resume)", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"CHECKPOINT_EVERY", {"--checkpoint-every"},
+         "writes a checkpoint whenever every thread has traced another k rays (default: 1048576)", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"RESUME", {"--resume"},
+         "continues the trace from the given checkpoint; the result equals the one of an "
+         "uninterrupted run", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"SNAPSHOT_EVERY", {"--snapshot-every"},
+         "writes a snapshot of the result (<outfile>.snapshot.<k>.vtp) whenever another k rays "
+         "have been traced", false});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"SNAPSHOT_SECONDS", {"--snapshot-seconds"},
+         "writes a snapshot of the result whenever another t seconds have passed", false});
+      optMan->addCmlParam(rti::util::clo::bool_option
+        {"PERF_COUNTERS", {"--perf-counters"},
+         "reports hardware performance counters per phase of the tracer (Linux perf_event_open)"});
+      optMan->addCmlParam(rti::util::clo::bool_option
+        {"PIN_THREADS", {"--pin-threads"},
+         "pins every thread to a CPU of its NUMA node and reports the rays per second per node"});
+      optMan->addCmlParam(rti::util::clo::bool_option
+        {"NUMA_REPLICATION", {"--numa-replication"},
+         "keeps a copy of the discs and their neighborhoods on every NUMA node (--multi-hit neighborhood)"});
+      optMan->addCmlParam(rti::util::clo::string_option
+        {"LOG_LEVEL", {"--log-level"},
+         "comma separated log levels out of trace, debug, info, warning, error, progress, all, none "
+         "(default: info,progress)", false});
       bool succ = optMan->parse_args(argc, argv);
       if (!succ) {
         std::cout << optMan->get_usage_msg();
         exit(EXIT_FAILURE);
       }
 
+      auto loglevels = optMan->get_string_option_value("LOG_LEVEL");
+      if ( ! loglevels.empty() && ! rti::util::logger::set_levels(loglevels)) {
+        std::cout << "Warning: unknown log level in \"" << loglevels << "\"; using defaults." << std::endl;
+      }
+
       std::string maxThreadsStr = optMan->get_string_option_value("MAX_THREADS");
       if ( ! maxThreadsStr.empty() ) {
         int maxThreads = std::stoi(maxThreadsStr);
@@ -98,6 +176,86 @@ namespace rti {
       return optMan;
     }
 
+    void init_ray_logger(rti::util::clo::manager& cmlopts) {
+      auto raylogfilename = cmlopts.get_string_option_value("RAY_LOG");
+      if (raylogfilename.empty()) {
+        return;
+      }
+      auto every = 1ull;
+      try {
+        every = std::stoull(cmlopts.get_string_option_value("RAY_LOG_EVERY"));
+      } catch (...) {}
+      auto primids = std::unordered_set<unsigned int> {};
+      auto primidsstr = std::stringstream {cmlopts.get_string_option_value("RAY_LOG_PRIMS")};
+      for (auto idstr = std::string {}; std::getline(primidsstr, idstr, ',');) {
+        try {
+          primids.insert((unsigned int) std::stoul(idstr));
+        } catch (...) {}
+      }
+      if ( ! rti::util::ray_logger::open(raylogfilename, every, primids)) {
+        std::cerr << "Warning: could not open ray log " << raylogfilename << std::endl;
+        return;
+      }
+      std::cout << "Logging every " << every << ". ray to " << raylogfilename << std::endl;
+    }
+
+    io::vtp_write_options get_vtp_write_options(rti::util::clo::manager& cmlopts) {
+      auto result = io::vtp_write_options {};
+      auto formatstr = cmlopts.get_string_option_value("OUTPUT_FORMAT");
+      if ( ! formatstr.empty() && ! io::vtp_write_options::parse_format(formatstr, result.format)) {
+        std::cout << "Warning: unknown output format \"" << formatstr << "\"; using auto." << std::endl;
+      }
+      auto compressionstr = cmlopts.get_string_option_value("OUTPUT_COMPRESSION");
+      if ( ! compressionstr.empty() &&
+           ! io::vtp_write_options::parse_compression(compressionstr, result.compression)) {
+        std::cout << "Warning: unknown output compression \"" << compressionstr << "\"; using zlib." << std::endl;
+      }
+      return result;
+    }
+
+    template<typename tracer_type>
+    typename tracer_type::multi_hit_engine get_multi_hit_engine(rti::util::clo::manager& cmlopts) {
+      auto result = tracer_type::multi_hit_engine::NEIGHBORHOOD;
+      auto enginestr = cmlopts.get_string_option_value("MULTI_HIT");
+      if ( ! enginestr.empty() && ! tracer_type::parse_multi_hit_engine(enginestr, result)) {
+        std::cout << "Warning: unknown multi-hit engine \"" << enginestr << "\"; using neighborhood." << std::endl;
+      }
+      return result;
+    }
+
+    // Parses a shard specification of the form "i/n" with i < n
+    bool parse_shard(std::string const& pStr, uint32_t& pIndex, uint32_t& pNumShards) {
+      auto slash = pStr.find('/');
+      if (slash == std::string::npos) {
+        return false;
+      }
+      try {
+        pIndex = (uint32_t) std::stoul(pStr.substr(0, slash));
+        pNumShards = (uint32_t) std::stoul(pStr.substr(slash + 1));
+      } catch (...) {
+        return false;
+      }
+      return pIndex < pNumShards;
+    }
+
+    // Exits on an error. Under MPI, a rank must not exit alone; the other
+    // ranks would wait in the reduction forever.
+    [[noreturn]]
+    void exit_with_failure(int pMpiSize) {
+#ifdef RTI_USE_MPI
+      if (pMpiSize > 1) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+      }
+#endif
+      exit(EXIT_FAILURE);
+    }
+
+    // Returns the number of rays out of pNumRays which shard pIndex out of
+    // pNumShards traces; the first shards trace the remainder.
+    unsigned long long get_share(unsigned long long pNumRays, uint32_t pIndex, uint32_t pNumShards) {
+      return pNumRays / pNumShards + (pIndex < pNumRays % pNumShards ? 1 : 0);
+    }
+
     void print_rtc_device_info(RTCDevice pDevice) {
       RLOG_INFO
         << "RTC_DEVICE_PROPERTY_TRIANGLE_GEOMETRY_SUPPORTED == "
@@ -140,9 +298,19 @@ int main(int argc, char* argv[]) {
   using numeric_type = float;
   using namespace rti;
 
+  // Without MPI (see the build option RTI_USE_MPI) there is a single rank.
+  auto mpirank = 0;
+  auto mpisize = 1;
+#ifdef RTI_USE_MPI
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpirank);
+  MPI_Comm_size(MPI_COMM_WORLD, &mpisize);
+#endif
+
   auto cmlopts = main::init(argc, argv);
   auto infilename = cmlopts->get_string_option_value("INPUT_FILE");
   auto outfilename = cmlopts->get_string_option_value("OUTPUT_FILE");
+  main::init_ray_logger(*cmlopts);
 
   // Enable huge page support.
   auto device_config = "hugepages=1";
@@ -167,14 +335,31 @@ int main(int argc, char* argv[]) {
       << "Please convert the input file to vtp (e.g., using Paraview) and rerun "
       << argv[0] << " with the new file." << std::endl;
     std::cout << "terminating" << std::endl;
-    exit(EXIT_FAILURE);
+    main::exit_with_failure(mpisize);
   }
   if (cmlopts->get_bool_option_value("TRIANGLES")) {
     std::cerr << "Triangles in this version of " << argv[0] << " not supported " << std::endl;
-    exit(EXIT_FAILURE);
+    main::exit_with_failure(mpisize);
+  }
+  auto timing = util::timing_record {};
+  auto totaltimer = util::timer {};
+  auto readprobe = util::timing_probe {timing.child("read")};
+  // The native binary format is memory mapped; other inputs are parsed as .vtp.
+  // In both cases Embree shares the buffers of the reader.
+  auto rtipcreader = std::unique_ptr<io::rtipc_point_cloud_reader<numeric_type> > {};
+  auto vtpreader = std::unique_ptr<io::vtp_point_cloud_reader<numeric_type> > {};
+  if (vtksys::SystemTools::GetFilenameLastExtension(infilename) == ".rtipc") {
+    rtipcreader = std::make_unique<io::rtipc_point_cloud_reader<numeric_type> >(infilename);
+    if ( ! rtipcreader->is_valid()) {
+      main::exit_with_failure(mpisize);
+    }
+  } else {
+    vtpreader = std::make_unique<io::vtp_point_cloud_reader<numeric_type> >(infilename);
   }
-  auto reader = io::vtp_point_cloud_reader<numeric_type> {infilename};
-  auto geometry = geo::point_cloud_disc_geometry<numeric_type> {device, reader};
+  readprobe.stop();
+  auto geometry = rtipcreader
+    ? geo::point_cloud_disc_geometry<numeric_type> {device, *rtipcreader}
+    : geo::point_cloud_disc_geometry<numeric_type> {device, vtpreader->get_buffers()};
   
   // Compute bounding box
   auto bdbox = geometry.get_bounding_box();
@@ -204,9 +389,37 @@ int main(int argc, char* argv[]) {
   
   auto numrays = 128 * 1024ull; // default value // magic number
   auto numraysstr = cmlopts->get_string_option_value("NUM_RAYS");
+  auto timebudget = 0.0;
+  try {
+    timebudget = std::stod(cmlopts->get_string_option_value("TIME_BUDGET"));
+  } catch (...) {}
+  if (timebudget > 0 && numraysstr.empty()) {
+    numrays = std::numeric_limits<decltype(numrays)>::max();
+  }
   try {
     numrays = std::stoull(numraysstr);
   } catch (...) {}
+  auto shardidx = 0u;
+  auto numshards = 0u;
+  auto shardstr = cmlopts->get_string_option_value("SHARD");
+  if ( ! shardstr.empty()) {
+    if ( ! main::parse_shard(shardstr, shardidx, numshards)) {
+      std::cerr << "Error: invalid shard \"" << shardstr << "\"; expected i/n with i < n" << std::endl;
+      main::exit_with_failure(mpisize);
+    }
+    numrays = main::get_share(numrays, shardidx, numshards);
+    std::cout << "Tracing shard " << shardidx << "/" << numshards << " with " << numrays << " rays" << std::endl;
+  }
+  if (mpisize > 1) {
+    if (numshards > 0) {
+      std::cerr << "Error: the option --shard cannot be combined with MPI" << std::endl;
+      main::exit_with_failure(mpisize);
+    }
+    // Every rank traces its share of the rays with its own random number stream
+    shardidx = (uint32_t) mpirank;
+    numrays = main::get_share(numrays, shardidx, (uint32_t) mpisize);
+    std::cout << "Tracing " << numrays << " rays on rank " << mpirank << "/" << mpisize << std::endl;
+  }
 
   //// Define particle
   // In order to pass a value into a local class we need to declare a static
@@ -230,13 +443,113 @@ int main(int argc, char* argv[]) {
   using reflection = reflection::diffuse<numeric_type>;
   auto tracer = trace::tracer<numeric_type, particle_t, reflection>
     {geometry, boundary, source, numrays};
+  tracer.set_perf_counters(cmlopts->get_bool_option_value("PERF_COUNTERS"));
+  tracer.set_analytic_boundary(cmlopts->get_bool_option_value("ANALYTIC_BOUNDARY"));
+  tracer.set_back_face_filter(cmlopts->get_bool_option_value("BACK_FACE_FILTER"));
+  tracer.set_pin_threads(cmlopts->get_bool_option_value("PIN_THREADS"));
+  tracer.set_numa_replication(cmlopts->get_bool_option_value("NUMA_REPLICATION"));
+  tracer.set_multi_hit_engine(main::get_multi_hit_engine<decltype(tracer)>(*cmlopts));
+  if (shardidx >= decltype(tracer)::get_num_rng_streams()) {
+    // Otherwise, ranks or shards would share random numbers
+    std::cerr
+      << "Error: at most " << decltype(tracer)::get_num_rng_streams()
+      << " shards or MPI ranks are supported" << std::endl;
+    main::exit_with_failure(mpisize);
+  }
+  tracer.set_rng_stream(shardidx);
+  tracer.set_time_budget(timebudget);
+  auto checkpointfilename = cmlopts->get_string_option_value("CHECKPOINT");
+  auto resumefilename = cmlopts->get_string_option_value("RESUME");
+  if (mpisize > 1) {
+    // One checkpoint per rank
+    auto ranksuffix = "." + std::to_string(mpirank);
+    if ( ! checkpointfilename.empty()) checkpointfilename += ranksuffix;
+    if ( ! resumefilename.empty()) resumefilename += ranksuffix;
+  }
+  if ( ! checkpointfilename.empty()) {
+    auto checkpointevery = 1024 * 1024ull; // default value
+    auto checkpointeverystr = cmlopts->get_string_option_value("CHECKPOINT_EVERY");
+    try {
+      checkpointevery = std::stoull(checkpointeverystr);
+    } catch (...) {}
+    tracer.set_checkpoint(checkpointfilename, std::max(checkpointevery, 1ull));
+  }
+  if ( ! resumefilename.empty()) {
+    if ( ! tracer.resume_from(resumefilename)) {
+      std::cerr << "Error: cannot resume from \"" << resumefilename
+                << "\"; not a checkpoint of this geometry and number of rays" << std::endl;
+      main::exit_with_failure(mpisize);
+    }
+    std::cout << "Resuming from " << resumefilename << std::endl;
+  }
+  auto snapshotwriter = std::unique_ptr<io::snapshot_writer<numeric_type> > {};
+  auto snapshotevery = 0ull;
+  auto snapshotseconds = 0.0;
+  try {
+    snapshotevery = std::stoull(cmlopts->get_string_option_value("SNAPSHOT_EVERY"));
+  } catch (...) {}
+  try {
+    snapshotseconds = std::stod(cmlopts->get_string_option_value("SNAPSHOT_SECONDS"));
+  } catch (...) {}
+  if (snapshotevery > 0 || snapshotseconds > 0) {
+    if (outfilename.empty() || numshards > 0 || mpisize > 1) {
+      std::cerr << "Warning: snapshots need an output file and are not available for shards and MPI runs" << std::endl;
+    } else {
+      auto snapshotbase = outfilename;
+      if (vtksys::SystemTools::GetFilenameLastExtension(snapshotbase) == ".vtp") {
+        snapshotbase = vtksys::SystemTools::GetFilenameWithoutLastExtension(snapshotbase);
+        auto snapshotpath = vtksys::SystemTools::GetFilenamePath(outfilename);
+        if ( ! snapshotpath.empty()) {
+          snapshotbase = snapshotpath + "/" + snapshotbase;
+        }
+      }
+      snapshotwriter = std::make_unique<io::snapshot_writer<numeric_type> >
+        (geometry, snapshotbase, main::get_vtp_write_options(*cmlopts));
+      tracer.set_snapshots
+        ([&snapshotwriter](auto pSnapshot, size_t pNumRays) {
+          snapshotwriter->submit(std::move(pSnapshot), pNumRays);
+        }, snapshotevery, snapshotseconds);
+    }
+  }
   auto result = tracer.run();
+  // Writes the last pending snapshot
+  snapshotwriter.reset();
+  // After the run, since the tracer builds the neighborhood of the geometry on demand
+  timing.merge(geometry.get_timing());
+  timing.merge(result.timing);
+#ifdef RTI_USE_MPI
+  if (mpisize > 1) {
+    auto reduceprobe = util::timing_probe {timing.child("mpi-allreduce")};
+    auto& acc = static_cast<trace::hit_accumulator<numeric_type>&> (*result.hitAccumulator);
+    result.hitAccumulator = trace::mpi_reducer::allreduce(acc, MPI_COMM_WORLD);
+    auto totalrays = (uint64_t) result.numRays;
+    MPI_Allreduce(MPI_IN_PLACE, &totalrays, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    result.numRays = totalrays;
+  }
+#endif
+  if (mpirank != 0) {
+    // Rank 0 writes the combined result
+    outfilename.clear();
+  }
+  util::logger::flush();
   std::cout << result << std::endl;
   //std::cout << *result.hitAccumulator << std::endl;
 
   std::cout << "after tracer" << std::endl << std::flush;
 
-  if ( ! outfilename.empty()) {
+  if (numshards > 0 && ! outfilename.empty()) {
+    if (vtksys::SystemTools::GetFilenameLastExtension(outfilename) != ".rtishard") {
+      std::cout << "Appending .rtishard to the given file name" << std::endl;
+      outfilename.append(".rtishard");
+    }
+    std::cout << "Writing shard to " << outfilename << std::endl;
+    auto writeprobe = util::timing_probe {timing.child("write")};
+    auto& acc = static_cast<trace::hit_accumulator<numeric_type>&> (*result.hitAccumulator);
+    if ( ! io::shard_format::write(acc, result.numRays, shardidx, numshards, outfilename)) {
+      std::cerr << "Error: could not write " << outfilename << std::endl;
+      main::exit_with_failure(mpisize);
+    }
+  } else if ( ! outfilename.empty()) {
     // Write output to file
     if (vtksys::SystemTools::GetFilenameLastExtension(outfilename) != ".vtp") {
       std::cout << "Appending .vtp to the given file name" << std::endl;
@@ -254,35 +567,54 @@ int main(int argc, char* argv[]) {
       ([](auto p1, auto const p2){return (p1+=" ")+=p2;}, "", std::vector<std::string> (argv, argv+argc));
     std::cerr << "cmdstr == " << cmdstr << std::endl;
     auto geoname = typeid(&geometry).name();    
+    auto metadata = std::vector<rti::util::pair<std::string> >
+      {{"running-time[ns]", std::to_string(result.timeNanoseconds)},
+       {"number-of-rays", std::to_string(result.numRays)},
+       {"git-hash", main::get_git_hash()},
+       {"cmd", cmdstr},
+       {"geo-name", geoname}};
+    // The time needed to write the output itself cannot be part of the meta data.
+    for (auto const& entry : timing.flatten()) {
+      metadata.push_back(entry);
+    }
+    auto writeoptions = main::get_vtp_write_options(*cmlopts);
+    auto writeprobe = util::timing_probe {timing.child("write")};
     io::vtp_writer<numeric_type>::write
       (geometry, 
        *result.hitAccumulator,
        outfilename,
-       // std::vector<rti::util::pair<std::string> >
-       {{"running-time[ns]", std::to_string(result.timeNanoseconds)},
-        {"git-hash", main::get_git_hash()},
-        {"cmd", cmdstr},
-        {"geo-name", geoname}});
+       metadata,
+       writeoptions);
     std::cout << "Writing bounding box to " << bbfilename << std::endl;
-    io::vtp_writer<numeric_type>::write(boundary, bbfilename);
-
-    auto raylog = RAYLOG_GET_PTR();
-    if (raylog != nullptr) {
-      auto raylogfilename = vtksys::SystemTools::
-        GetFilenameWithoutExtension(outfilename).append(".ray-log.vtp");
-      std::cout << "Writing ray log to " << raylogfilename << std::endl;
-      io::vtp_writer<numeric_type>::write(raylog, raylogfilename);
-    }
-    auto raysrclog = RAYSRCLOG_GET_PTR();
-    if (raysrclog != nullptr) {
-      auto raysrclogfilename = vtksys::SystemTools::
-        GetFilenameWithoutExtension(outfilename).append(".ray-src-log.vtp");
-      std::cout << "Writing ray src log to " << raysrclogfilename << std::endl;
-      io::vtp_writer<numeric_type>::write(raysrclog, raysrclogfilename);
+    io::vtp_writer<numeric_type>::write(boundary, bbfilename, writeoptions);
+  }
+  timing.add_nanoseconds(totaltimer.elapsed_nanoseconds());
+#ifdef RTI_USE_MPI
+  if (mpisize > 1) {
+    // The timing of all the ranks is printed by rank 0
+    auto timingstream = std::stringstream {};
+    timing.print(timingstream);
+    auto timings = trace::mpi_reducer::gather_strings(timingstream.str(), 0, MPI_COMM_WORLD);
+    for (size_t idx = 0; idx < timings.size(); ++idx) {
+      std::cout << "[rank " << idx << "]" << std::endl << timings[idx];
     }
   }
+#endif
+  if (mpisize == 1) {
+    timing.print(std::cout);
+  }
+
+  if (util::ray_logger::is_enabled()) {
+    std::cout
+      << "Ray log written to " << util::ray_logger::get_file_name()
+      << " (convert it with rti-ray-log-to-vtp)" << std::endl;
+    util::ray_logger::close();
+  }
 
   rtcReleaseDevice(device);
+#ifdef RTI_USE_MPI
+  MPI_Finalize();
+#endif
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <embree3/rtcore.h>
+
+#include "../geo/point_cloud_disc_geometry.hpp"
+#include "../io/rtipc_point_cloud_reader.hpp"
+#include "../io/shard_format.hpp"
+#include "../io/vtp_point_cloud_reader.hpp"
+#include "../io/vtp_writer.hpp"
+#include "../trace/hit_accumulator.hpp"
+#include "../util/clo.hpp"
+#include "../util/timer.hpp"
+
+// Merges the shard files of a run (see the option --shard of rti) into one
+// result and writes it together with the geometry to a .vtp file. The sums of
+// the shards add up to the sums of a single run with the total number of rays.
+
+int main(int argc, char* argv[]) {
+  using namespace rti;
+  using numeric_type = float;
+  auto optMan = std::make_unique<util::clo::manager>();
+  optMan->addCmlParam(util::clo::string_option
+    {"INPUT_FILE", {"--infile", "-i"},
+     "specifies the path of the point cloud which the shards have been traced on (.vtp or .rtipc)", true});
+  optMan->addCmlParam(util::clo::string_option
+    {"SHARDS", {"--shards", "-s"}, "specifies the comma separated paths of the shard files", true});
+  optMan->addCmlParam(util::clo::string_option
+    {"OUTPUT_FILE", {"--outfile", "-o"}, "specifies the path of the output file (.vtp)", true});
+  optMan->addCmlParam(util::clo::string_option
+    {"OUTPUT_FORMAT", {"--output-format"},
+     "specifies the encoding of the output file out of ascii, binary, appended, auto", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"OUTPUT_COMPRESSION", {"--output-compression"},
+     "specifies the compression of binary output out of none, zlib, lz4", false});
+  if ( ! optMan->parse_args(argc, argv)) {
+    std::cout << optMan->get_usage_msg();
+    exit(EXIT_FAILURE);
+  }
+  auto infilename = optMan->get_string_option_value("INPUT_FILE");
+  auto outfilename = optMan->get_string_option_value("OUTPUT_FILE");
+  auto writeoptions = io::vtp_write_options {};
+  auto formatstr = optMan->get_string_option_value("OUTPUT_FORMAT");
+  if ( ! formatstr.empty() && ! io::vtp_write_options::parse_format(formatstr, writeoptions.format)) {
+    std::cout << "Warning: unknown output format \"" << formatstr << "\"; using auto." << std::endl;
+  }
+  auto compressionstr = optMan->get_string_option_value("OUTPUT_COMPRESSION");
+  if ( ! compressionstr.empty() &&
+       ! io::vtp_write_options::parse_compression(compressionstr, writeoptions.compression)) {
+    std::cout << "Warning: unknown output compression \"" << compressionstr << "\"; using zlib." << std::endl;
+  }
+
+  auto timer = util::timer {};
+  auto merged = std::unique_ptr<trace::hit_accumulator<numeric_type> > {};
+  auto numrays = 0ull;
+  auto numshards = 0u;
+  auto seen = std::vector<bool> {};
+  auto shardsstream = std::stringstream {optMan->get_string_option_value("SHARDS")};
+  for (auto shardfilename = std::string {}; std::getline(shardsstream, shardfilename, ',');) {
+    auto hh = io::shard_format::header {};
+    auto acc = io::shard_format::read<numeric_type>(shardfilename, hh);
+    if ( ! acc) {
+      std::cerr << "Error: " << shardfilename << " is not a shard file of version "
+                << io::shard_format::sVersion << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (merged == nullptr) {
+      numshards = hh.numshards;
+      seen.resize(numshards, false);
+      merged = std::move(acc);
+    } else {
+      if (hh.numshards != numshards || hh.numprims != merged->get_s1s().size()) {
+        std::cerr << "Error: " << shardfilename << " does not belong to the same run" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      *merged = trace::hit_accumulator<numeric_type> {*merged, *acc};
+    }
+    if (hh.shardindex >= numshards) {
+      std::cerr << "Error: invalid shard index in " << shardfilename << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (seen[hh.shardindex]) {
+      std::cerr << "Error: shard " << hh.shardindex << " is given twice" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    seen[hh.shardindex] = true;
+    numrays += hh.numrays;
+  }
+  if (merged == nullptr) {
+    std::cerr << "Error: no shard files given" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  for (size_t idx = 0; idx < seen.size(); ++idx) {
+    if ( ! seen[idx]) {
+      std::cout << "Warning: shard " << idx << "/" << numshards << " is missing" << std::endl;
+    }
+  }
+  std::cout << "Merged shards of " << numrays << " rays in " << timer.elapsed_seconds() << " seconds" << std::endl;
+
+  auto device = rtcNewDevice("");
+  auto rtipcreader = std::unique_ptr<io::rtipc_point_cloud_reader<numeric_type> > {};
+  auto vtpreader = std::unique_ptr<io::vtp_point_cloud_reader<numeric_type> > {};
+  if (vtksys::SystemTools::GetFilenameLastExtension(infilename) == ".rtipc") {
+    rtipcreader = std::make_unique<io::rtipc_point_cloud_reader<numeric_type> >(infilename);
+    if ( ! rtipcreader->is_valid()) {
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    vtpreader = std::make_unique<io::vtp_point_cloud_reader<numeric_type> >(infilename);
+  }
+  auto geometry = rtipcreader
+    ? geo::point_cloud_disc_geometry<numeric_type> {device, *rtipcreader}
+    : geo::point_cloud_disc_geometry<numeric_type> {device, vtpreader->get_buffers()};
+  if (geometry.get_num_primitives() != merged->get_s1s().size()) {
+    std::cerr << "Error: the shards do not fit the point cloud " << infilename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  auto metadata = std::vector<util::pair<std::string> >
+    {{"number-of-rays", std::to_string(numrays)},
+     {"number-of-shards", std::to_string(numshards)}};
+  std::cout << "Writing output to " << outfilename << std::endl;
+  io::vtp_writer<numeric_type>::write(geometry, *merged, outfilename, metadata, writeoptions);
+  rtcReleaseDevice(device);
+  return EXIT_SUCCESS;
+}
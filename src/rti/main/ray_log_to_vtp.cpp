@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string>
+
+#include "../io/ray_log_reader.hpp"
+#include "../io/vtp_writer.hpp"
+#include "../util/clo.hpp"
+
+// Converts a binary ray log (written by rti::util::ray_logger) into two .vtp files:
+// one containing the ray segments and one containing the ray source points.
+
+int main(int argc, char* argv[]) {
+  using namespace rti;
+  auto optMan = std::make_unique<util::clo::manager>();
+  optMan->addCmlParam(util::clo::string_option
+    {"INPUT_FILE", {"--infile", "-i"}, "specifies the path of the binary ray log", true});
+  optMan->addCmlParam(util::clo::string_option
+    {"OUTPUT_FILE", {"--outfile", "-o"}, "specifies the path of the output file (without extension)", true});
+  if ( ! optMan->parse_args(argc, argv)) {
+    std::cout << optMan->get_usage_msg();
+    exit(EXIT_FAILURE);
+  }
+  auto infilename = optMan->get_string_option_value("INPUT_FILE");
+  auto outfilename = optMan->get_string_option_value("OUTPUT_FILE");
+  if (vtksys::SystemTools::GetFilenameLastExtension(outfilename) == ".vtp") {
+    auto outpath = vtksys::SystemTools::GetFilenamePath(outfilename);
+    if( ! outpath.empty()) {
+      outpath.append("/");
+    }
+    outfilename = outpath + vtksys::SystemTools::GetFilenameWithoutExtension(outfilename);
+  }
+
+  auto reader = io::ray_log_reader {infilename};
+  if ( ! reader.is_valid()) {
+    exit(EXIT_FAILURE);
+  }
+  auto raylogfilename = outfilename + ".ray-log.vtp";
+  std::cout
+    << "Writing " << reader.get_segments().size() << " ray segments to " << raylogfilename << std::endl;
+  io::vtp_writer<float>::write(&reader.get_segments(), raylogfilename);
+  auto raysrclogfilename = outfilename + ".ray-src-log.vtp";
+  std::cout
+    << "Writing " << reader.get_sources().size() << " ray sources to " << raysrclogfilename << std::endl;
+  io::vtp_writer<float>::write(&reader.get_sources(), raysrclogfilename);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <omp.h>
+#include <string>
+
+#include "../service/server.hpp"
+#include "../util/clo.hpp"
+#include "../util/logger.hpp"
+
+// A long-running tracing service on a Unix domain socket (see
+// service::server). Coupling codes which trace many times per simulation
+// connect with service::client instead of starting rti for every step; the
+// Embree device, the OpenMP threads and the scene of the last geometry stay
+// warm between the requests. SIGINT and SIGTERM stop the service after the
+// current request.
+
+namespace {
+  rti::service::server* gServer = nullptr;
+
+  extern "C" void handle_signal(int)
+  {
+    if (gServer != nullptr) {
+      gServer->stop();
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  using namespace rti;
+  auto optMan = std::make_unique<util::clo::manager>();
+  optMan->addCmlParam(util::clo::string_option
+    {"SOCKET", {"--socket"}, "specifies the path of the Unix domain socket to listen on", true});
+  optMan->addCmlParam(util::clo::string_option
+    {"MAX_THREADS", {"--max-threads", "-m"}, "specifies the maximum number of threads used", false});
+  optMan->addCmlParam(util::clo::string_option
+    {"LOG_LEVEL", {"--log-level"},
+     "comma separated log levels out of trace, debug, info, warning, error, progress, all, none", false});
+  if ( ! optMan->parse_args(argc, argv)) {
+    std::cout << optMan->get_usage_msg();
+    exit(EXIT_FAILURE);
+  }
+  auto loglevels = optMan->get_string_option_value("LOG_LEVEL");
+  if ( ! loglevels.empty() && ! util::logger::set_levels(loglevels)) {
+    std::cout << "Warning: unknown log level in \"" << loglevels << "\"; using defaults." << std::endl;
+  }
+  auto maxThreadsStr = optMan->get_string_option_value("MAX_THREADS");
+  if ( ! maxThreadsStr.empty()) {
+    auto maxThreads = std::stoi(maxThreadsStr);
+    if (maxThreads < omp_get_max_threads()) {
+      omp_set_num_threads(maxThreads);
+    }
+  }
+  std::cout << "Maximum number of threads used == " << omp_get_max_threads() << std::endl;
+
+  auto server = service::server {optMan->get_string_option_value("SOCKET")};
+  if ( ! server.is_valid()) {
+    exit(EXIT_FAILURE);
+  }
+  gServer = &server;
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
+  server.serve();
+  gServer = nullptr;
+  util::logger::flush();
+  std::cout << "Served " << server.get_num_requests() << " requests" << std::endl;
+  return EXIT_SUCCESS;
+}
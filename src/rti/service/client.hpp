@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "protocol.hpp"
+
+namespace rti { namespace service {
+
+  // A connection to a tracing service (see service::server and rti-service).
+  // The client does not depend on Embree or VTK.
+  //
+  // Example:
+  //   auto client = rti::service::client {"/tmp/rti.socket"};
+  //   auto request = rti::service::protocol::request {};
+  //   request.points = ...; request.normals = ...; request.spacings = {0.1f};
+  //   request.numrays = 1000000;
+  //   auto response = rti::service::protocol::response {};
+  //   client.trace(request, response);
+  //   // Next time step on the same surface with another sticking coefficient
+  //   request.flags = rti::service::protocol::sReuseGeometry;
+  //   request.stickingc = 0.5f;
+  //   client.trace(request, response);
+  class client {
+  public:
+    // Connects to the service; see is_valid()
+    client(std::string const& pSocketPath)
+    {
+      auto addr = sockaddr_un {};
+      addr.sun_family = AF_UNIX;
+      if (pSocketPath.size() >= sizeof(addr.sun_path)) {
+        return;
+      }
+      std::strcpy(addr.sun_path, pSocketPath.c_str());
+      auto sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (sock < 0) {
+        return;
+      }
+      if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(sock);
+        return;
+      }
+      mSocket = sock;
+    }
+
+    ~client()
+    {
+      if (mSocket >= 0) {
+        ::close(mSocket);
+      }
+    }
+
+    client(client const&) = delete;
+    client& operator=(client const&) = delete;
+
+    bool is_valid() const
+    {
+      return mSocket >= 0;
+    }
+
+    // Sends the request and waits for its response (reusing the memory of
+    // the vectors of pResponse). Returns false if the connection failed;
+    // then the client is not valid anymore. A request which the service
+    // rejects is answered with a status other than OK.
+    bool trace(protocol::request const& pRequest, protocol::response& pResponse)
+    {
+      if ( ! is_valid()) {
+        return false;
+      }
+      if (protocol::write_request(mSocket, pRequest) &&
+          protocol::read_response(mSocket, pResponse)) {
+        return true;
+      }
+      ::close(mSocket);
+      mSocket = -1;
+      return false;
+    }
+
+  private:
+    int mSocket = -1;
+  };
+}} // namespace
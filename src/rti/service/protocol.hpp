@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// The binary protocol of the tracing service (see service::server and
+// service::client) on a Unix domain stream socket.
+//
+// A client sends requests and receives one response per request, in order,
+// on the same connection. A request is a request_header followed by the
+// arrays of the geometry: numpoints points (3 floats each), numpoints normals
+// (3 floats each) and numspacings grid spacings (1 float each; numspacings
+// is 1 or numpoints). numpoints is at least 1. A request with the flag sReuseGeometry carries no
+// arrays; it traces the geometry of the previous request of the connection.
+// A response is a response_header followed, if the status is OK, by
+// numpoints Monte Carlo estimates (float) and numpoints hit counts (uint64).
+// All values are in the byte order of the machine; the socket is local.
+
+namespace rti { namespace service {
+
+  class protocol {
+  public:
+    static constexpr char sRequestMagic[8] = {'R', 'T', 'I', 'S', 'V', 'R', 'Q', '0'};
+    static constexpr char sResponseMagic[8] = {'R', 'T', 'I', 'S', 'V', 'R', 'S', '0'};
+    static constexpr uint32_t sVersion = 1;
+    // Larger requests are rejected before memory is allocated for them
+    static constexpr uint64_t sMaxPoints = 1ull << 31;
+
+    // Flags of a request
+    static constexpr uint32_t sReuseGeometry = 1u << 0;
+
+    // The values of geo::bound_condition
+    static constexpr uint32_t sReflective = 0;
+    static constexpr uint32_t sPeriodic = 1;
+
+    enum class status : uint32_t { OK = 0, BAD_REQUEST = 1, NO_GEOMETRY = 2 };
+
+    struct request_header {
+      char magic[8];
+      uint32_t version;
+      uint32_t headersize;
+      uint32_t flags;
+      uint32_t xcond;
+      uint32_t ycond;
+      float stickingc;
+      uint64_t numpoints;
+      uint64_t numspacings;
+      uint64_t numrays;
+      // Seconds; 0 for no limit (see device::set_time_budget())
+      double timebudget;
+    };
+
+    struct response_header {
+      char magic[8];
+      uint32_t version;
+      uint32_t headersize;
+      status stat;
+      uint32_t reserved;
+      uint64_t numpoints;
+      // The number of rays traced; less than requested if the time budget
+      // was exhausted
+      uint64_t numrays;
+      // Durations on the side of the server: the preparation of the scene
+      // and the trace, and the whole request including the transfers
+      uint64_t preparenanoseconds;
+      uint64_t tracenanoseconds;
+      uint64_t requestnanoseconds;
+    };
+
+    struct request {
+      uint32_t flags = 0;
+      uint32_t xcond = sReflective;
+      uint32_t ycond = sReflective;
+      float stickingc = 1;
+      uint64_t numrays = 1024;
+      double timebudget = 0;
+      std::vector<float> points;
+      std::vector<float> normals;
+      std::vector<float> spacings;
+    };
+
+    struct response {
+      status stat = status::OK;
+      uint64_t numrays = 0;
+      uint64_t preparenanoseconds = 0;
+      uint64_t tracenanoseconds = 0;
+      uint64_t requestnanoseconds = 0;
+      std::vector<float> mcestimates;
+      std::vector<uint64_t> hitcnts;
+    };
+
+    // The functions below return false if the connection fails or the
+    // message is malformed; then the connection should be closed.
+
+    static
+    bool write_request(int pSocket, request const& pRequest)
+    {
+      auto hh = request_header {};
+      std::memcpy(hh.magic, sRequestMagic, sizeof(hh.magic));
+      hh.version = sVersion;
+      hh.headersize = sizeof(hh);
+      hh.flags = pRequest.flags;
+      hh.xcond = pRequest.xcond;
+      hh.ycond = pRequest.ycond;
+      hh.stickingc = pRequest.stickingc;
+      hh.numrays = pRequest.numrays;
+      hh.timebudget = pRequest.timebudget;
+      if ((pRequest.flags & sReuseGeometry) == 0) {
+        hh.numpoints = pRequest.points.size() / 3;
+        hh.numspacings = pRequest.spacings.size();
+        if (hh.numpoints == 0 ||
+            pRequest.normals.size() != pRequest.points.size() ||
+            ! (hh.numspacings == 1 || hh.numspacings == hh.numpoints)) {
+          return false;
+        }
+      }
+      return send_all(pSocket, &hh, sizeof(hh)) &&
+        (hh.numpoints == 0 ||
+         (send_vector(pSocket, pRequest.points) &&
+          send_vector(pSocket, pRequest.normals) &&
+          send_vector(pSocket, pRequest.spacings)));
+    }
+
+    // Reads the arrays into the vectors of pRequest (reusing their memory).
+    // If the request reuses the geometry, the arrays are left untouched.
+    static
+    bool read_request(int pSocket, request& pRequest)
+    {
+      auto hh = request_header {};
+      if ( ! recv_all(pSocket, &hh, sizeof(hh)) ||
+           std::memcmp(hh.magic, sRequestMagic, sizeof(hh.magic)) != 0 ||
+           hh.version != sVersion ||
+           hh.headersize != sizeof(hh)) {
+        return false;
+      }
+      pRequest.flags = hh.flags;
+      pRequest.xcond = hh.xcond;
+      pRequest.ycond = hh.ycond;
+      pRequest.stickingc = hh.stickingc;
+      pRequest.numrays = hh.numrays;
+      pRequest.timebudget = hh.timebudget;
+      if ((hh.flags & sReuseGeometry) != 0) {
+        return true;
+      }
+      if (hh.numpoints == 0 || hh.numpoints > sMaxPoints ||
+          ! (hh.numspacings == 1 || hh.numspacings == hh.numpoints)) {
+        return false;
+      }
+      return recv_vector(pSocket, pRequest.points, 3 * hh.numpoints) &&
+        recv_vector(pSocket, pRequest.normals, 3 * hh.numpoints) &&
+        recv_vector(pSocket, pRequest.spacings, hh.numspacings);
+    }
+
+    static
+    bool write_response(int pSocket, response const& pResponse)
+    {
+      auto hh = response_header {};
+      std::memcpy(hh.magic, sResponseMagic, sizeof(hh.magic));
+      hh.version = sVersion;
+      hh.headersize = sizeof(hh);
+      hh.stat = pResponse.stat;
+      hh.numrays = pResponse.numrays;
+      hh.preparenanoseconds = pResponse.preparenanoseconds;
+      hh.tracenanoseconds = pResponse.tracenanoseconds;
+      hh.requestnanoseconds = pResponse.requestnanoseconds;
+      if (pResponse.stat == status::OK) {
+        hh.numpoints = pResponse.mcestimates.size();
+        if (pResponse.hitcnts.size() != hh.numpoints) {
+          return false;
+        }
+      }
+      return send_all(pSocket, &hh, sizeof(hh)) &&
+        (hh.numpoints == 0 ||
+         (send_vector(pSocket, pResponse.mcestimates) &&
+          send_vector(pSocket, pResponse.hitcnts)));
+    }
+
+    static
+    bool read_response(int pSocket, response& pResponse)
+    {
+      auto hh = response_header {};
+      if ( ! recv_all(pSocket, &hh, sizeof(hh)) ||
+           std::memcmp(hh.magic, sResponseMagic, sizeof(hh.magic)) != 0 ||
+           hh.version != sVersion ||
+           hh.headersize != sizeof(hh)) {
+        return false;
+      }
+      pResponse.stat = hh.stat;
+      pResponse.numrays = hh.numrays;
+      pResponse.preparenanoseconds = hh.preparenanoseconds;
+      pResponse.tracenanoseconds = hh.tracenanoseconds;
+      pResponse.requestnanoseconds = hh.requestnanoseconds;
+      if (hh.numpoints > sMaxPoints) {
+        return false;
+      }
+      return recv_vector(pSocket, pResponse.mcestimates, hh.numpoints) &&
+        recv_vector(pSocket, pResponse.hitcnts, hh.numpoints);
+    }
+
+  private:
+    static
+    bool send_all(int pSocket, void const* pData, size_t pSize)
+    {
+      auto data = static_cast<char const*>(pData);
+      while (pSize > 0) {
+        // No SIGPIPE if the peer has closed the connection
+        auto sent = ::send(pSocket, data, pSize, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+          continue;
+        }
+        if (sent <= 0) {
+          return false;
+        }
+        data += sent;
+        pSize -= (size_t) sent;
+      }
+      return true;
+    }
+
+    static
+    bool recv_all(int pSocket, void* pData, size_t pSize)
+    {
+      auto data = static_cast<char*>(pData);
+      while (pSize > 0) {
+        auto received = ::recv(pSocket, data, pSize, 0);
+        if (received < 0 && errno == EINTR) {
+          continue;
+        }
+        if (received <= 0) {
+          return false;
+        }
+        data += received;
+        pSize -= (size_t) received;
+      }
+      return true;
+    }
+
+    template<typename Ty>
+    static
+    bool send_vector(int pSocket, std::vector<Ty> const& pValues)
+    {
+      return send_all(pSocket, pValues.data(), pValues.size() * sizeof(Ty));
+    }
+
+    template<typename Ty>
+    static
+    bool recv_vector(int pSocket, std::vector<Ty>& pValues, uint64_t pSize)
+    {
+      pValues.resize(pSize);
+      return recv_all(pSocket, pValues.data(), pSize * sizeof(Ty));
+    }
+  };
+}} // namespace
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "protocol.hpp"
+#include "../device.hpp"
+#include "../reflection/diffuse.hpp"
+#include "../util/logger.hpp"
+#include "../util/timer.hpp"
+
+namespace rti { namespace service {
+
+  // The particle of the service; its sticking coefficient is the one of the
+  // current request.
+  class sticking_particle : public particle::i_particle<float> {
+  public:
+    float get_sticking_probability(RTCRay& pRayIn, RTCHit& pHitIn, geo::meta_geometry<float>& pGeometry,
+                                   rng::i_rng& pRng, rng::i_rng::i_state& pRngState) override final
+    {
+      return sStickingC;
+    }
+    void init_new() override final {}
+    inline static float sStickingC = 1;
+  };
+
+  // A tracing service on a Unix domain socket (see service::protocol and
+  // rti-service).
+  //
+  // The server keeps one rti::device alive for all requests; hence, the
+  // OpenMP threads, the memory of the device and, as long as the clients
+  // trace the same geometry (see protocol::sReuseGeometry), the scene with
+  // its BVH stay warm between the requests. The connections are served one
+  // after another; further clients wait in the backlog of the socket.
+  class server {
+  public:
+    using device_type = rti::device<float, sticking_particle, reflection::diffuse<float> >;
+
+    // Listens on pSocketPath; a stale socket file at that path is replaced.
+    // See is_valid().
+    server(std::string pSocketPath) :
+      mSocketPath(std::move(pSocketPath))
+    {
+      auto addr = sockaddr_un {};
+      addr.sun_family = AF_UNIX;
+      if (mSocketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: socket path too long: " << mSocketPath << std::endl;
+        return;
+      }
+      std::strcpy(addr.sun_path, mSocketPath.c_str());
+      struct stat st {};
+      if (::stat(mSocketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(mSocketPath.c_str());
+      }
+      auto sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (sock < 0 ||
+          ::bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+          ::listen(sock, sBacklog) != 0) {
+        std::cerr << "Error: cannot listen on " << mSocketPath << ": " << std::strerror(errno) << std::endl;
+        if (sock >= 0) {
+          ::close(sock);
+        }
+        return;
+      }
+      mListenSocket = sock;
+    }
+
+    ~server()
+    {
+      if (mListenSocket >= 0) {
+        ::close(mListenSocket);
+        ::unlink(mSocketPath.c_str());
+      }
+    }
+
+    server(server const&) = delete;
+    server& operator=(server const&) = delete;
+
+    bool is_valid() const
+    {
+      return mListenSocket >= 0;
+    }
+
+    // Serves connections until stop() is called. The device is created on
+    // the calling thread, which is the thread whose OpenMP team traces.
+    void serve()
+    {
+      if ( ! is_valid()) {
+        return;
+      }
+      if (mDevice == nullptr) {
+        mDevice = std::make_unique<device_type>();
+        mDevice->set_keep_scene(true);
+      }
+      RLOG_INFO << "Listening on " << mSocketPath << std::endl;
+      while ( ! mStop.load()) {
+        auto conn = ::accept(mListenSocket, nullptr, nullptr);
+        if (conn < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          break; // stopped or failed
+        }
+        mConnection.store(conn);
+        // A connection could have been accepted right after stop()
+        if ( ! mStop.load()) {
+          handle_connection(conn);
+        }
+        mConnection.store(-1);
+        ::close(conn);
+      }
+    }
+
+    // Makes serve() return after the current request. Only async-signal-safe
+    // calls; hence, it may be called from a signal handler.
+    void stop()
+    {
+      mStop.store(true);
+      ::shutdown(mListenSocket, SHUT_RDWR);
+      auto conn = mConnection.load();
+      if (conn >= 0) {
+        ::shutdown(conn, SHUT_RD);
+      }
+    }
+
+    size_t get_num_requests() const
+    {
+      return mNumRequests.load();
+    }
+
+  private:
+    void handle_connection(int pSocket)
+    {
+      // The geometry of a connection is not visible to the next one
+      mHasGeometry = false;
+      while (protocol::read_request(pSocket, mRequest)) {
+        auto requesttimer = util::timer {};
+        handle(mRequest, mResponse);
+        mResponse.requestnanoseconds = requesttimer.elapsed_nanoseconds();
+        mNumRequests.fetch_add(1);
+        if ( ! protocol::write_response(pSocket, mResponse)) {
+          break;
+        }
+      }
+    }
+
+    // Fills pResponse, reusing the memory of its vectors
+    void handle(protocol::request const& pRequest, protocol::response& pResponse)
+    {
+      pResponse.mcestimates.clear();
+      pResponse.hitcnts.clear();
+      pResponse.numrays = 0;
+      pResponse.preparenanoseconds = 0;
+      pResponse.tracenanoseconds = 0;
+      if ((pRequest.flags & protocol::sReuseGeometry) == 0) {
+        // The arrays of the previous geometry have been overwritten
+        mHasGeometry = false;
+      }
+      pResponse.stat = check(pRequest);
+      if (pResponse.stat != protocol::status::OK) {
+        return;
+      }
+      auto& device = *mDevice;
+      if ((pRequest.flags & protocol::sReuseGeometry) == 0) {
+        // The device copies the arrays into its scene before run() returns
+        auto numpoints = pRequest.points.size() / 3;
+        device.set_points(pRequest.points.data(), numpoints);
+        device.set_normals(pRequest.normals.data(), numpoints);
+        device.set_grid_spacing(pRequest.spacings.data(), pRequest.spacings.size());
+        mHasGeometry = true;
+      }
+      device.set_x(get_bound_condition(pRequest.xcond));
+      device.set_y(get_bound_condition(pRequest.ycond));
+      device.set_number_of_rays(pRequest.numrays);
+      device.set_time_budget(pRequest.timebudget);
+      sticking_particle::sStickingC = pRequest.stickingc;
+      device.run();
+      auto mcestimates = device.get_mc_estimates_view();
+      auto hitcnts = device.get_hit_cnts_view();
+      pResponse.mcestimates.assign(mcestimates.data(), mcestimates.data() + mcestimates.size());
+      pResponse.hitcnts.assign(hitcnts.data(), hitcnts.data() + hitcnts.size());
+      pResponse.numrays = device.get_number_of_rays_traced();
+      for (auto const& phase : device.get_timing().get_children()) {
+        if (phase.get_name() == "prepare") {
+          pResponse.preparenanoseconds = phase.get_nanoseconds();
+        } else if (phase.get_name() == "trace") {
+          pResponse.tracenanoseconds = phase.get_nanoseconds();
+        }
+      }
+    }
+
+    protocol::status check(protocol::request const& pRequest) const
+    {
+      if ((pRequest.flags & protocol::sReuseGeometry) != 0) {
+        if ( ! mHasGeometry) {
+          return protocol::status::NO_GEOMETRY;
+        }
+      } else if (pRequest.points.empty()) {
+        return protocol::status::BAD_REQUEST;
+      }
+      if ( ! (0 < pRequest.stickingc && pRequest.stickingc <= 1) ||
+          pRequest.numrays == 0 ||
+          pRequest.xcond > protocol::sPeriodic ||
+          pRequest.ycond > protocol::sPeriodic) {
+        return protocol::status::BAD_REQUEST;
+      }
+      return protocol::status::OK;
+    }
+
+    static
+    bound_condition get_bound_condition(uint32_t pCond)
+    {
+      return pCond == protocol::sPeriodic ? bound_condition::PERIODIC : bound_condition::REFLECTIVE;
+    }
+
+    static constexpr int sBacklog = 16;
+    std::string mSocketPath;
+    int mListenSocket = -1;
+    std::atomic<int> mConnection {-1};
+    std::atomic<bool> mStop {false};
+    std::atomic<size_t> mNumRequests {0};
+    std::unique_ptr<device_type> mDevice;
+    bool mHasGeometry = false;
+    // Reused by all requests
+    protocol::request mRequest;
+    protocol::response mResponse;
+  };
+}} // namespace
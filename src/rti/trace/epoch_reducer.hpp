@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "hit_accumulator.hpp"
+#include "../rng/mt64_rng.hpp"
+
+namespace rti { namespace trace {
+
+  // The state of one thread of the tracer which is needed to continue its
+  // share of the rays (e.g., from a checkpoint)
+  struct thread_progress {
+    static constexpr size_t sNumRngStates = 7;
+    uint64_t raysdone = 0;
+    uint64_t hitc = 0;
+    uint64_t nonhitc = 0;
+    uint64_t reflectc = 0;
+    std::array<rng::mt64_rng::state, sNumRngStates> rngstates;
+  };
+
+  // Reduces the per-thread accumulators of the tracer epoch by epoch.
+  //
+  // Every thread traces its share of the rays in epochs of a fixed number of
+  // rays. At the end of an epoch a thread hands its accumulator in (submit())
+  // and continues with a second, empty one (double buffering). The thread
+  // which completes an epoch adds the accumulators of that epoch to the
+  // result in the order of the thread numbers. Hence, the result depends on
+  // the number of threads and the length of the epochs only; it does not
+  // depend on the timing of the threads. The other threads keep tracing while
+  // an epoch is added; a thread waits only if it completes two further epochs
+  // in the meantime.
+  //
+  // A thread may stop early (e.g., at a deadline): its last submit() does not
+  // ask for a next accumulator, and the later epochs are completed without
+  // it.
+  //
+  // After an epoch has been added, the reducer calls the callback set with
+  // set_on_epoch() (e.g., to write a checkpoint) on the same thread.
+  template<typename numeric_type>
+  class epoch_reducer {
+  public:
+    using accumulator_type = hit_accumulator<numeric_type>;
+    using callback_type =
+      std::function<void (uint64_t, accumulator_type&, std::vector<thread_progress> const&)>;
+
+    epoch_reducer(size_t pNumPrims, size_t pNumThreads) :
+      mNumPrims(pNumPrims),
+      mResult(std::make_unique<accumulator_type>(pNumPrims)),
+      mProgress(pNumThreads),
+      mSlots(pNumThreads),
+      mSubmitted {0, 0},
+      mLastEpochs(pNumThreads, sNotFinished) {}
+
+    // Continues from a previous state, e.g., read from a checkpoint, in which
+    // pEpochs epochs have been added
+    void restore(std::unique_ptr<accumulator_type> pResult,
+                 uint64_t pEpochs,
+                 std::vector<thread_progress> pProgress)
+    {
+      assert(pProgress.size() == mProgress.size() && "Precondition");
+      mResult = std::move(pResult);
+      mEpochs = pEpochs;
+      mProgress = std::move(pProgress);
+    }
+
+    // The callback receives the number of epochs which have been added, the
+    // result so far and the progress of all threads at the end of that epoch.
+    void set_on_epoch(callback_type pCallback)
+    {
+      mOnEpoch = std::move(pCallback);
+    }
+
+    uint64_t get_num_epochs() const
+    {
+      return mEpochs;
+    }
+
+    thread_progress const& get_progress(size_t pThread) const
+    {
+      return mProgress[pThread];
+    }
+
+    // Hands in the accumulator of epoch pEpoch of thread pThread. Returns an
+    // empty accumulator for the next epoch if pNeedsNext is set; otherwise
+    // the thread is finished and nullptr is returned.
+    std::unique_ptr<accumulator_type>
+    submit(size_t pThread, uint64_t pEpoch, std::unique_ptr<accumulator_type> pAcc,
+           thread_progress const& pProgress, bool pNeedsNext)
+    {
+      auto buffer = pEpoch % 2;
+      auto lock = std::unique_lock<std::mutex> {mMutex};
+      // The slot is free when the epoch before the previous one has been added
+      mAdded.wait(lock, [&] { return mEpochs + 1 >= pEpoch; });
+      auto& slot = mSlots[pThread][buffer];
+      auto next = std::move(slot.acc);
+      slot.acc = std::move(pAcc);
+      slot.progress = pProgress;
+      mSubmitted[buffer] += 1;
+      if ( ! pNeedsNext) {
+        mLastEpochs[pThread] = pEpoch;
+      }
+      // Epochs are added in order and by one thread at a time. The thread
+      // which adds an epoch also adds the following ones if they are complete.
+      while ( ! mAdding && is_complete(mEpochs)) {
+        mAdding = true;
+        auto epoch = mEpochs;
+        mSubmitted[epoch % 2] = 0;
+        auto lastepochs = mLastEpochs;
+        lock.unlock();
+        add(epoch, lastepochs);
+        lock.lock();
+        mEpochs = epoch + 1;
+        mAdding = false;
+        mAdded.notify_all();
+      }
+      lock.unlock();
+      if ( ! pNeedsNext) {
+        return nullptr;
+      }
+      if (next == nullptr) {
+        return std::make_unique<accumulator_type>(mNumPrims);
+      }
+      return next;
+    }
+
+    // Precondition: all threads have finished
+    std::unique_ptr<accumulator_type> take_result()
+    {
+      return std::move(mResult);
+    }
+
+  private:
+    static constexpr uint64_t sNotFinished = std::numeric_limits<uint64_t>::max();
+
+    // Whether all the threads have submitted pEpoch or finished before
+    bool is_complete(uint64_t pEpoch)
+    {
+      auto submitted = mSubmitted[pEpoch % 2];
+      if (submitted == 0) {
+        return false;
+      }
+      for (auto last : mLastEpochs) {
+        if (last < pEpoch) {
+          submitted += 1;
+        }
+      }
+      return submitted == mSlots.size();
+    }
+
+    // Adds the accumulators of one epoch; the slots of this epoch are not
+    // touched by other threads until mEpochs is increased.
+    void add(uint64_t pEpoch, std::vector<uint64_t> const& pLastEpochs)
+    {
+      for (size_t tt = 0; tt < mSlots.size(); ++tt) {
+        if (pLastEpochs[tt] < pEpoch) {
+          continue; // finished before
+        }
+        auto& slot = mSlots[tt][pEpoch % 2];
+        mResult->add(*slot.acc);
+        mProgress[tt] = slot.progress;
+        // The accumulator is handed out again for a later epoch
+        slot.acc->clear();
+      }
+      if (mOnEpoch) {
+        mOnEpoch(pEpoch + 1, *mResult, mProgress);
+      }
+    }
+
+    struct slot_type {
+      std::unique_ptr<accumulator_type> acc;
+      thread_progress progress;
+    };
+
+    size_t mNumPrims;
+    std::unique_ptr<accumulator_type> mResult;
+    std::vector<thread_progress> mProgress;
+    std::vector<std::array<slot_type, 2> > mSlots;
+    std::array<size_t, 2> mSubmitted;
+    // The last epoch of every thread which has finished
+    std::vector<uint64_t> mLastEpochs;
+    uint64_t mEpochs = 0;
+    bool mAdding = false;
+    callback_type mOnEpoch;
+    std::mutex mMutex;
+    std::condition_variable mAdded;
+  };
+}} // namespace
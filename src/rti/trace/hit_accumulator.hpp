@@ -1,5 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
 #include "i_hit_accumulator.hpp"
 
 namespace rti { namespace trace {
@@ -21,6 +28,29 @@ namespace rti { namespace trace {
       mS4s(pSize,0) {
     }
 
+    // Restores an accumulator from its raw sums (see io::shard_format)
+    hit_accumulator(std::vector<size_t> pCnts,
+                    size_t pTotalCnts,
+                    std::vector<numeric_type> pExposedAreas,
+                    std::vector<internal_numeric_type> pS1s,
+                    std::vector<internal_numeric_type> pS2s,
+                    std::vector<internal_numeric_type> pS3s,
+                    std::vector<internal_numeric_type> pS4s) :
+      mAcc(pS1s), // the values equal the sums S1
+      mCnts(std::move(pCnts)),
+      mTotalCnts(pTotalCnts),
+      exposedareas(std::move(pExposedAreas)),
+      mS1s(std::move(pS1s)),
+      mS2s(std::move(pS2s)),
+      mS3s(std::move(pS3s)),
+      mS4s(std::move(pS4s)) {
+      assert(mCnts.size() == mS1s.size() &&
+             mS1s.size() == mS2s.size() &&
+             mS2s.size() == mS3s.size() &&
+             mS3s.size() == mS4s.size() &&
+             "Error: size missmatch");
+    }
+
     hit_accumulator(hit_accumulator<numeric_type> const& pA) :
       mAcc(pA.mAcc), // copy construct the vector member
       mCnts(pA.mCnts),
@@ -48,35 +78,7 @@ namespace rti { namespace trace {
                                 hit_accumulator<numeric_type> const& pA2) :
       // Precondition: the size of the accumulators are equal
       hit_accumulator(pA1) { // copy construct from the first argument
-      assert(pA1.mAcc.size() == pA2.mAcc.size() &&
-             pA1.mCnts.size() == pA2.mCnts.size() &&
-             pA1.mS1s.size() == pA2.mS1s.size() &&
-             pA1.mS2s.size() == pA2.mS2s.size() &&
-             pA1.mS3s.size() == pA2.mS3s.size() &&
-             pA1.mS4s.size() == pA2.mS4s.size() &&
-             "Error: size missmatch");
-      for (size_t idx = 0; idx < mAcc.size(); ++idx) {
-        mAcc[idx] += pA2.mAcc[idx];
-        mCnts[idx] += pA2.mCnts[idx];
-        mS1s[idx] += pA2.mS1s[idx];
-        mS2s[idx] += pA2.mS2s[idx];
-        mS3s[idx] += pA2.mS3s[idx];
-        mS4s[idx] += pA2.mS4s[idx];
-      }
-      mTotalCnts = pA1.mTotalCnts + pA2.mTotalCnts;
-      /* Assertions about the exposed areas saved in the input instances */
-      assert(pA1.exposedareas.size() == pA2.exposedareas.size());
-      assert(exposedareas.size() == pA1.exposedareas.size());
-      for (size_t idx = 0; idx < pA1.exposedareas.size(); ++idx) {
-        assert(
-          ( pA1.exposedareas[idx] == 0 ||
-            pA2.exposedareas[idx] == 0 ||
-            pA1.exposedareas[idx] == pA2.exposedareas[idx] )
-          && "Correctness Assumption");
-        exposedareas[idx] =
-          pA1.exposedareas[idx] > pA2.exposedareas[idx] ?
-          pA1.exposedareas[idx] : pA2.exposedareas[idx];
-      }
+      add(pA2);
     }
 
     // Assignment operators corresponding to the constructors
@@ -124,6 +126,51 @@ namespace rti { namespace trace {
       return *this;
     }
 
+    // Adds the sums and counts of pOther to this accumulator (in place; the
+    // same as the combining constructor)
+    void add(hit_accumulator<numeric_type> const& pOther) {
+      assert(mAcc.size() == pOther.mAcc.size() &&
+             mCnts.size() == pOther.mCnts.size() &&
+             mS1s.size() == pOther.mS1s.size() &&
+             mS2s.size() == pOther.mS2s.size() &&
+             mS3s.size() == pOther.mS3s.size() &&
+             mS4s.size() == pOther.mS4s.size() &&
+             "Error: size missmatch");
+      for (size_t idx = 0; idx < mAcc.size(); ++idx) {
+        mAcc[idx] += pOther.mAcc[idx];
+        mCnts[idx] += pOther.mCnts[idx];
+        mS1s[idx] += pOther.mS1s[idx];
+        mS2s[idx] += pOther.mS2s[idx];
+        mS3s[idx] += pOther.mS3s[idx];
+        mS4s[idx] += pOther.mS4s[idx];
+      }
+      mTotalCnts += pOther.mTotalCnts;
+      /* Assertions about the exposed areas saved in the input instances */
+      assert(exposedareas.size() == pOther.exposedareas.size());
+      for (size_t idx = 0; idx < exposedareas.size(); ++idx) {
+        assert(
+          ( exposedareas[idx] == 0 ||
+            pOther.exposedareas[idx] == 0 ||
+            exposedareas[idx] == pOther.exposedareas[idx] )
+          && "Correctness Assumption");
+        if (pOther.exposedareas[idx] > exposedareas[idx]) {
+          exposedareas[idx] = pOther.exposedareas[idx];
+        }
+      }
+    }
+
+    // Resets the sums, the counts and the exposed areas to zero
+    void clear() {
+      std::fill(mAcc.begin(), mAcc.end(), 0);
+      std::fill(mCnts.begin(), mCnts.end(), 0);
+      mTotalCnts = 0;
+      std::fill(exposedareas.begin(), exposedareas.end(), 0);
+      std::fill(mS1s.begin(), mS1s.end(), 0);
+      std::fill(mS2s.begin(), mS2s.end(), 0);
+      std::fill(mS3s.begin(), mS3s.end(), 0);
+      std::fill(mS4s.begin(), mS4s.end(), 0);
+    }
+
     // Member Functions
     void use(unsigned int pPrimID, numeric_type value) override final {
       assert(pPrimID < mAcc.size() && "primitive ID is out of bounds");
@@ -145,6 +192,14 @@ namespace rti { namespace trace {
       return mCnts;
     }
 
+    std::vector<internal_numeric_type> const& get_values_ref() const override final {
+      return mAcc;
+    }
+
+    std::vector<size_t> const& get_cnts_ref() const override final {
+      return mCnts;
+    }
+
     size_t get_cnts_sum() override final {
       return mTotalCnts;
     }
@@ -258,6 +313,29 @@ namespace rti { namespace trace {
       return exposedareas;
     }
 
+    std::vector<numeric_type> const& get_exposed_areas_ref() const override final
+    {
+      return exposedareas;
+    }
+
+    // The raw sums; together with the counts and the exposed areas they
+    // describe the accumulator completely.
+    std::vector<internal_numeric_type> const& get_s1s() const {
+      return mS1s;
+    }
+
+    std::vector<internal_numeric_type> const& get_s2s() const {
+      return mS2s;
+    }
+
+    std::vector<internal_numeric_type> const& get_s3s() const {
+      return mS3s;
+    }
+
+    std::vector<internal_numeric_type> const& get_s4s() const {
+      return mS4s;
+    }
+
     void print(std::ostream& pOs) const override final {
       pOs << "(";
       auto const* separator = " ";
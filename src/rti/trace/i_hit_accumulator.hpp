@@ -17,6 +17,10 @@ namespace rti { namespace trace {
     virtual std::vector<internal_numeric_type> get_vov() = 0;
     virtual void set_exposed_areas(std::vector<numeric_type>&) = 0;
     virtual std::vector<numeric_type> get_exposed_areas() = 0;
+    // Without copies; valid as long as the accumulator is not changed
+    virtual std::vector<internal_numeric_type> const& get_values_ref() const = 0;
+    virtual std::vector<size_t> const& get_cnts_ref() const = 0;
+    virtual std::vector<numeric_type> const& get_exposed_areas_ref() const = 0;
     virtual void print(std::ostream& pOs) const = 0;
   };
 }}
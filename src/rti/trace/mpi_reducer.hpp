@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include "hit_accumulator.hpp"
+
+// Combines the results of the ranks of an MPI run (see the build option
+// RTI_USE_MPI). Every rank traces its share of the rays with its own random
+// number stream (see tracer::set_rng_stream()); the sums of the accumulators
+// of all ranks equal the sums of a single run with all the rays.
+
+namespace rti { namespace trace {
+
+  class mpi_reducer {
+  public:
+
+    // Sums the accumulators of all ranks of pComm (all-reduce); every rank
+    // receives the sum. The exposed areas are equal on all ranks and are
+    // taken as they are.
+    template<typename numeric_type>
+    static
+    std::unique_ptr<hit_accumulator<numeric_type> >
+    allreduce(hit_accumulator<numeric_type>& pAcc, MPI_Comm pComm)
+    {
+      auto cnts64 = std::vector<uint64_t> {};
+      for (auto cc : pAcc.get_cnts()) {
+        cnts64.push_back(cc);
+      }
+      allreduce_sum(cnts64, MPI_UINT64_T, pComm);
+      auto totalcnts = (uint64_t) pAcc.get_cnts_sum();
+      MPI_Allreduce(MPI_IN_PLACE, &totalcnts, 1, MPI_UINT64_T, MPI_SUM, pComm);
+      auto s1s = pAcc.get_s1s();
+      auto s2s = pAcc.get_s2s();
+      auto s3s = pAcc.get_s3s();
+      auto s4s = pAcc.get_s4s();
+      for (auto* ss : {&s1s, &s2s, &s3s, &s4s}) {
+        allreduce_sum(*ss, MPI_DOUBLE, pComm);
+      }
+      return std::make_unique<hit_accumulator<numeric_type> >
+        (std::vector<size_t> (cnts64.begin(), cnts64.end()),
+         (size_t) totalcnts,
+         pAcc.get_exposed_areas(),
+         std::move(s1s), std::move(s2s), std::move(s3s), std::move(s4s));
+    }
+
+    // Gathers one string per rank on the rank pRoot (in the order of the
+    // ranks); the other ranks receive an empty vector.
+    static
+    std::vector<std::string> gather_strings(std::string const& pStr, int pRoot, MPI_Comm pComm)
+    {
+      auto rank = 0;
+      auto size = 0;
+      MPI_Comm_rank(pComm, &rank);
+      MPI_Comm_size(pComm, &size);
+      auto length = (int) pStr.size();
+      auto lengths = std::vector<int> (rank == pRoot ? size : 0);
+      MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, pRoot, pComm);
+      auto offsets = std::vector<int> (lengths.size(), 0);
+      for (size_t idx = 1; idx < lengths.size(); ++idx) {
+        offsets[idx] = offsets[idx - 1] + lengths[idx - 1];
+      }
+      auto buffer = std::string (lengths.empty() ? 0 : offsets.back() + lengths.back(), '\0');
+      MPI_Gatherv(pStr.data(), length, MPI_CHAR,
+                  &buffer[0], lengths.data(), offsets.data(), MPI_CHAR, pRoot, pComm);
+      auto result = std::vector<std::string> {};
+      for (size_t idx = 0; idx < lengths.size(); ++idx) {
+        result.push_back(buffer.substr(offsets[idx], lengths[idx]));
+      }
+      return result;
+    }
+
+  private:
+    template<typename value_type>
+    static
+    void allreduce_sum(std::vector<value_type>& pValues, MPI_Datatype pType, MPI_Comm pComm)
+    {
+      // The count of MPI calls is an int; reduce large arrays in chunks.
+      constexpr size_t chunksize = 1 << 30;
+      for (size_t start = 0; start < pValues.size(); start += chunksize) {
+        auto count = (int) std::min(chunksize, pValues.size() - start);
+        MPI_Allreduce(MPI_IN_PLACE, pValues.data() + start, count, pType, MPI_SUM, pComm);
+      }
+    }
+  };
+}} // namespace
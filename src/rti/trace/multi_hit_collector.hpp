@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace rti { namespace trace {
+
+  // Collects the front face hits of one ray during the traversal of the BVH,
+  // that is, from the intersect filter function of the disc geometry (see
+  // tracer::set_multi_hit_engine()). Embree does not report the candidates in
+  // the order of their distance, and a closer hit with a larger epsilon may
+  // extend the range of the closest hit found so far. Hence, the collector
+  // keeps every candidate; the candidates beyond the range of the final
+  // closest hit are skipped when the hits are used.
+  template<typename numeric_type>
+  class multi_hit_collector {
+  public:
+
+    struct hit {
+      numeric_type tfar;
+      unsigned int primID;
+    };
+
+    void clear()
+    {
+      mHits.clear();
+      mClosestIdx = 0;
+      mLimit = sMax;
+    }
+
+    // The largest pEps of any hit. Without it, every hit is kept in range
+    // (see add()).
+    void set_max_eps(numeric_type pMaxEps)
+    {
+      mMaxEps = pMaxEps;
+    }
+
+    // Adds a hit at distance pTFar. If it is the closest hit so far, then
+    // pEps (e.g., a multiple of the radius of the disc) defines the range of
+    // further hits. Returns false if the hit lies beyond the range of any hit
+    // closer than the closest one so far. The filter function may then accept
+    // the hit and thereby shorten the ray.
+    bool add(numeric_type pTFar, unsigned int pPrimID, numeric_type pEps)
+    {
+      mHits.push_back({pTFar, pPrimID});
+      if (mHits.size() == 1 || pTFar < mHits[mClosestIdx].tfar) {
+        mClosestIdx = mHits.size() - 1;
+        mLimit = pTFar + pEps;
+      }
+      return pTFar <= mHits[mClosestIdx].tfar + mMaxEps;
+    }
+
+    bool empty() const
+    {
+      return mHits.empty();
+    }
+
+    // Precondition: ! empty()
+    hit const& get_closest() const
+    {
+      return mHits[mClosestIdx];
+    }
+
+    // Calls pFun(primID) for every hit in range except the closest one
+    template<typename fun_type>
+    void for_each_additional(fun_type pFun) const
+    {
+      for (size_t idx = 0; idx < mHits.size(); ++idx) {
+        if (idx != mClosestIdx && mHits[idx].tfar <= mLimit) {
+          pFun(mHits[idx].primID);
+        }
+      }
+    }
+
+  private:
+    static constexpr numeric_type sMax = std::numeric_limits<numeric_type>::max();
+
+    std::vector<hit> mHits;
+    size_t mClosestIdx = 0;
+    numeric_type mLimit = sMax;
+    numeric_type mMaxEps = sMax;
+  };
+}} // namespace
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+#include "hit_accumulator.hpp"
+
+namespace rti { namespace trace {
+
+  // The progress of a run of the tracer (see tracer::set_progress_callback())
+  struct progress_report {
+    // Rays traced so far (including the ones of a checkpoint resumed from)
+    size_t numRays = 0;
+    // Rays traced per second of this run
+    double raysPerSecond = 0;
+    // The mean relative error of the primitives which have been hit
+    double relativeError = 0;
+
+    template<typename numeric_type>
+    static
+    double get_mean_relative_error(hit_accumulator<numeric_type>& pAcc)
+    {
+      auto sum = 0.0;
+      auto cnt = 0ull;
+      for (auto re : pAcc.get_relative_error()) {
+        if (re == std::numeric_limits<decltype(re)>::max()) {
+          continue; // not hit
+        }
+        sum += re;
+        cnt += 1;
+      }
+      return cnt == 0 ? std::numeric_limits<double>::max() : sum / cnt;
+    }
+  };
+}} // namespace
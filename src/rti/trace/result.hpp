@@ -1,9 +1,15 @@
 #pragma once
 
+#include <map>
+#include <string>
+#include <vector>
+
 #include "i_hit_accumulator.hpp"
 // include ostream overload template to provide out stream functionality
 // by means of the print function.
 #include "../util/ostream_overload_template.hpp"
+#include "../util/perf_counter_group.hpp"
+#include "../util/timing.hpp"
 
 namespace rti { namespace trace {
   // import name from ostream_overload_template.hpp into local namespace
@@ -18,6 +24,19 @@ namespace rti { namespace trace {
     size_t numRays;
     size_t hitc;
     size_t nonhitc;
+    // number of reflections on the surface (bounces)
+    size_t reflectc = 0;
+    // Whether the run was stopped by a util::cancellation_token
+    bool cancelled = false;
+    // The rays per second of the ray loop on every NUMA node; empty unless
+    // the threads are pinned (see tracer::set_pin_threads())
+    std::vector<double> raysPerSecondPerNode;
+    // Durations of the phases of the tracer; timeNanoseconds is the sum of
+    // "ray-loop", "exposed-areas" and "reduce".
+    util::timing_record timing {"trace"};
+    // Hardware performance counts per phase summed over all threads; empty
+    // unless enabled with tracer::set_perf_counters().
+    std::map<std::string, util::perf_counts> perfCounts;
 
     void print(std::ostream& pOs) const {
       pOs
@@ -29,6 +48,16 @@ namespace rti { namespace trace {
         // << nonhitc << "nonhits "
         << timeNanoseconds*1e-9 << "seconds"
         << std::endl;
+      for (size_t node = 0; node < raysPerSecondPerNode.size(); ++node) {
+        pOs << "[numa node " << node << "] " << raysPerSecondPerNode[node] << " rays/s" << std::endl;
+      }
+      for (auto const& phasecounts : perfCounts) {
+        pOs << "[perf " << phasecounts.first << "] per ray: ";
+        phasecounts.second.print(pOs, (double) numRays);
+        pOs << std::endl << "[perf " << phasecounts.first << "] per hit: ";
+        phasecounts.second.print(pOs, (double) hitc);
+        pOs << std::endl;
+      }
     }
   };
 }}
@@ -7,23 +7,35 @@
 #include <sys/stat.h>
 
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <omp.h>
+#include <string>
 
 #include <embree3/rtcore.h>
 
 #include "dummy_counter.hpp"
+#include "epoch_reducer.hpp"
 #include "hit_accumulator.hpp"
 #include "local_intersector.hpp"
+#include "multi_hit_collector.hpp"
+#include "progress_report.hpp"
 //#include "point_cloud_context.hpp"
 #include "result.hpp"
 //#include "../geo/absc_point_cloud_geometry.hpp"
 #include "../geo/disc_bounding_box_intersector.hpp"
 #include "../geo/boundary_x_y.hpp"
+#include "../geo/disc_side_tables.hpp"
 #include "../geo/absc_geometry.hpp"
-#include "../io/vtp_writer.hpp"
+#include "../geo/point_cloud_disc_geometry.hpp"
+#include "../io/checkpoint_format.hpp"
 #include "../mc/rejection_control.hpp"
 #include "../particle/i_particle.hpp"
 //#include "../ray/constant_direction.hpp"
@@ -31,9 +43,13 @@
 #include "../ray/i_source.hpp"
 #include "../reflection/i_reflection.hpp"
 #include "../rng/mt64_rng.hpp"
+#include "../util/cancellation_token.hpp"
 #include "../util/logger.hpp"
+#include "../util/numa.hpp"
+#include "../util/perf_counter_group.hpp"
 #include "../util/ray_logger.hpp"
 #include "../util/timer.hpp"
+#include "../util/timing.hpp"
 
 namespace rti { namespace trace {
     
@@ -44,6 +60,15 @@ namespace rti { namespace trace {
     static_assert(std::is_base_of<reflection::i_reflection<numeric_type>, reflection_type>::value, "Precondition");
     
   public:
+
+    // How the tracer finds the discs which a ray hits in addition to the
+    // closest one (discs overlap).
+    //  NEIGHBORHOOD: intersects the ray with the neighbors of the closest disc
+    //    (requires the neighborhood of the geometry).
+    //  FILTER: collects the front face hits within a few radii behind the
+    //    closest hit in an intersect filter function during the traversal of
+    //    the BVH. The neighborhood is not needed.
+    enum class multi_hit_engine {NEIGHBORHOOD, FILTER};
     
     tracer
     (geo::point_cloud_disc_geometry<numeric_type>& pGeometry,
@@ -63,12 +88,191 @@ namespace rti { namespace trace {
       RLOG_WARNING << "Warning: tnear set to a constant! FIX" << std::endl;
     }
 
-    trace::result<numeric_type> run()
+    ~tracer()
     {
-      // Prepare a data structure for the result.
-      auto result = trace::result<numeric_type> {};
-      result.inputFilePath = mGeometry.get_input_file_path();
-      result.geometryClassName = typeid(mGeometry).name();
+      release_scene();
+    }
+
+    // Enables per-thread hardware performance counters around the phases of
+    // run(). The counts are reported in trace::result::perfCounts.
+    void set_perf_counters(bool pEnable)
+    {
+      mPerfCounters = pEnable;
+    }
+
+    // Handles the boundary analytically instead of adding its triangles to the
+    // Embree scene. The ray is clipped at the wall of the bounding box (tfar)
+    // and, if it does not hit the geometry before, wrapped or reflected in
+    // closed form. This saves the traversals which return boundary hits.
+    void set_analytic_boundary(bool pEnable)
+    {
+      mAnalyticBoundary = pEnable;
+    }
+
+    // Rejects hits on the back faces of the discs in an intersect filter
+    // function, that is, during the traversal of the BVH. Otherwise the host
+    // loop moves the origin of the ray to the back face hit and starts a new
+    // traversal.
+    void set_back_face_filter(bool pEnable)
+    {
+      mBackFaceFilter = pEnable;
+    }
+
+    // See multi_hit_engine. The FILTER engine rejects back face hits in the
+    // filter function, too.
+    void set_multi_hit_engine(multi_hit_engine pEngine)
+    {
+      mMultiHitEngine = pEngine;
+    }
+
+    // Selects one out of get_num_rng_streams() decorrelated streams of
+    // random numbers (e.g., one per shard of a run). Stream 0 is the default.
+    void set_rng_stream(unsigned int pStream)
+    {
+      assert(pStream < get_num_rng_streams() && "Precondition");
+      mRngStream = pStream;
+    }
+
+    static
+    constexpr unsigned int get_num_rng_streams()
+    {
+      return 1u << (32 - sRngStreamShift);
+    }
+
+    // Writes a checkpoint to pFilename (see io::checkpoint_format) whenever
+    // every thread has traced another pRaysPerThread rays. The checkpoint is
+    // written by the thread which completes the epoch; the other threads do
+    // not wait for it.
+    void set_checkpoint(std::string const& pFilename, size_t pRaysPerThread)
+    {
+      assert(pRaysPerThread > 0 && "Precondition");
+      mCheckpointFile = pFilename;
+      mCheckpointRays = pRaysPerThread;
+    }
+
+    // Continues the next run() from the checkpoint pFilename. The run uses
+    // the number of threads and the epoch length stored in the checkpoint;
+    // hence, its result equals the one of an uninterrupted run. Returns false
+    // if the file cannot be read or belongs to another geometry or number of
+    // rays.
+    bool resume_from(std::string const& pFilename)
+    {
+      auto content = std::make_unique<io::checkpoint_format::content<numeric_type> >();
+      if ( ! io::checkpoint_format::read(pFilename, *content) ||
+           content->hh.numprims != mGeometry.get_num_primitives() ||
+           content->hh.numrays != mNumRays ||
+           content->hh.numthreads == 0 ||
+           content->hh.raysperepoch == 0) {
+        return false;
+      }
+      mResume = std::move(content);
+      return true;
+    }
+
+    // Stops tracing after about pSeconds seconds of run() (0: no budget). The
+    // threads check the time every sStopCheckRays rays and stop
+    // cooperatively. The number of rays of the constructor is an upper bound
+    // then (pass std::numeric_limits<size_t>::max() for a budget only);
+    // trace::result::numRays reports the number of rays actually traced.
+    void set_time_budget(double pSeconds)
+    {
+      mTimeBudget = pSeconds;
+    }
+
+    // Stops tracing (like the time budget) once pToken is cancelled;
+    // trace::result::cancelled is set then.
+    void set_cancellation_token(util::cancellation_token pToken)
+    {
+      mCancellationToken = std::move(pToken);
+    }
+
+    using progress_callback = std::function<void (trace::progress_report const&)>;
+
+    // Calls pCallback about every pSeconds seconds on a tracing thread (at
+    // the end of an epoch; see trace::epoch_reducer). The callback should
+    // return quickly. An empty pCallback turns the reports off.
+    void set_progress_callback(progress_callback pCallback, double pSeconds)
+    {
+      assert(( ! pCallback || pSeconds > 0) && "Precondition");
+      mProgressCallback = std::move(pCallback);
+      mProgressSeconds = pSeconds;
+    }
+
+    // Receives a snapshot of the result and the number of rays it contains
+    using snapshot_callback =
+      std::function<void (std::unique_ptr<trace::hit_accumulator<numeric_type> >, size_t)>;
+
+    // Takes snapshots of the result while the threads keep tracing: whenever
+    // another pRays rays have been traced or pSeconds seconds have passed
+    // (0 disables a trigger). A snapshot is the sum of the accumulators of
+    // all threads up to the end of an epoch (see trace::epoch_reducer); it is
+    // taken by the thread which completes the epoch. pCallback runs on that
+    // thread and should hand the snapshot over (e.g., to an
+    // io::snapshot_writer).
+    void set_snapshots(snapshot_callback pCallback, size_t pRays, double pSeconds)
+    {
+      mSnapshotCallback = std::move(pCallback);
+      mSnapshotRays = pRays;
+      mSnapshotSeconds = pSeconds;
+    }
+
+    // Keeps the scene (the BVH and the exposed areas) after run() such that
+    // the next run() traces it without preparing it again. The options which
+    // affect the scene (the analytic boundary and the filter functions) take
+    // effect at the next prepare() only.
+    void set_keep_scene(bool pKeep)
+    {
+      mKeepScene = pKeep;
+    }
+
+    // Pins thread t of run() to the same CPU in every run (see
+    // util::numa_topology) unless the OpenMP runtime binds the threads itself
+    // (OMP_PROC_BIND). The threads are unpinned when run() returns. The
+    // per-thread accumulators, which every thread allocates itself, then stay
+    // local to its NUMA node, and result::raysPerSecondPerNode reports the
+    // throughput of every node.
+    void set_pin_threads(bool pPin)
+    {
+      mPinThreads = pPin;
+    }
+
+    // Reads the discs, the normals and the neighborhood of the NEIGHBORHOOD
+    // multi-hit engine from one copy per NUMA node (see
+    // geo::disc_side_tables) instead of from the geometry. The copies are
+    // made on the first run and cost the memory of the geometry and its
+    // neighborhood per node. Intended for use with set_pin_threads().
+    void set_numa_replication(bool pReplicate)
+    {
+      mNumaReplication = pReplicate;
+    }
+
+    // Parses "neighborhood" or "filter"; returns false for other strings.
+    static
+    bool parse_multi_hit_engine(std::string const& pStr, multi_hit_engine& pEngine)
+    {
+      if (pStr == "neighborhood") {
+        pEngine = multi_hit_engine::NEIGHBORHOOD;
+      } else if (pStr == "filter") {
+        pEngine = multi_hit_engine::FILTER;
+      } else {
+        return false;
+      }
+      return true;
+    }
+
+    // Builds the Embree scene, the neighborhood of the geometry (if the
+    // multi-hit engine needs it) and the exposed areas of the discs on
+    // pNumThreads threads. run() calls it if the scene has not been prepared
+    // before. Preparing earlier, e.g., on a few threads while another tracer
+    // traces, hides the setup behind that trace. The next run() consumes the
+    // prepared scene.
+    void prepare(int pNumThreads)
+    {
+      release_scene();
+      mPrepareTiming = util::timing_record {};
+      mPreparePerfCounts.clear();
+      // The copies of the geometry may be stale
+      mNodeTables.clear();
 
       // Prepare Embree
       auto rtcdevice = mGeometry.get_rtc_device();
@@ -86,44 +290,197 @@ namespace rti { namespace trace {
       rtcSetSceneBuildQuality(rtcscene, bbquality);
       auto rtcgeometry = mGeometry.get_rtc_geometry();
       auto rtcboundary = mBoundary.get_rtc_geometry();
+      auto filterhits = mMultiHitEngine == multi_hit_engine::FILTER;
+      if (filterhits) {
+        rtcSetGeometryUserData(rtcgeometry, &mGeometry);
+        rtcSetGeometryIntersectFilterFunction(rtcgeometry, &collect_front_face_hits);
+      } else if (mBackFaceFilter) {
+        rtcSetGeometryUserData(rtcgeometry, &mGeometry);
+        rtcSetGeometryIntersectFilterFunction(rtcgeometry, &reject_back_face_hits);
+      } else {
+        rtcSetGeometryIntersectFilterFunction(rtcgeometry, nullptr);
+      }
+      rtcCommitGeometry(rtcgeometry);
 
-      auto boundaryID = rtcAttachGeometry(rtcscene, rtcboundary);
+      auto boundaryID = mAnalyticBoundary
+        ? RTC_INVALID_GEOMETRY_ID
+        : rtcAttachGeometry(rtcscene, rtcboundary);
       auto geometryID = rtcAttachGeometry(rtcscene, rtcgeometry);
 
       assert(rtcGetDeviceError(rtcdevice) == RTC_ERROR_NONE && "Error");
 
-      // Use openMP for parallelization
-      #pragma omp parallel
+      { // Use openMP for parallelization
+        auto commitprobe = util::timing_probe {mPrepareTiming.child("scene-commit")};
+        #pragma omp parallel num_threads(pNumThreads)
+        {
+          auto perfgroup = new_perf_counter_group_if_enabled();
+          if (perfgroup) perfgroup->start();
+          rtcJoinCommitScene(rtcscene);
+          if (perfgroup) add_perf_counts(mPreparePerfCounts, "scene-commit", perfgroup->stop());
+        }
+      }
+
+      if ( ! filterhits) {
+        // Built on first use; the durations are in the timing of the geometry
+        mGeometry.build_neighborhood();
+      } else {
+        mMaxMultiHitEps = get_max_multi_hit_eps();
+      }
+
+      // The exposed areas do not depend on the rays. They are computed before
+      // the rays are traced such that the snapshots contain them.
+      mDiscAreas.assign(mGeometry.get_num_primitives(), 0);
       {
-        rtcJoinCommitScene(rtcscene);
-        // TODO: move to the other parallel region at the bottom
+        auto areasprobe = util::timing_probe {mPrepareTiming.child("exposed-areas")};
+        #pragma omp parallel num_threads(pNumThreads)
+        {
+          auto perfgroup = new_perf_counter_group_if_enabled();
+          if (perfgroup) perfgroup->start();
+          compute_disc_areas(mGeometry, mBoundary, mDiscAreas);
+          if (perfgroup) add_perf_counts(mPreparePerfCounts, "exposed-areas", perfgroup->stop());
+        }
       }
+      mScene = rtcscene;
+      mGeometryID = geometryID;
+      mBoundaryID = boundaryID;
+    }
 
-      result.numRays = mNumRays;
+    trace::result<numeric_type> run()
+    {
+      // The time budget includes the setup of the scene
+      auto runtimer = util::timer {};
+      // Prepare a data structure for the result.
+      auto result = trace::result<numeric_type> {};
+      result.inputFilePath = mGeometry.get_input_file_path();
+      result.geometryClassName = typeid(mGeometry).name();
 
-      auto boundaryReflection = reflection::specular<numeric_type> {};
+      if (mScene == nullptr) {
+        prepare(omp_get_max_threads());
+      }
+      for (auto const& phase : mPrepareTiming.get_children()) {
+        result.timing.merge(phase);
+      }
+      result.perfCounts = mPreparePerfCounts;
+      // A kept scene is not prepared again (see set_keep_scene())
+      mPrepareTiming = util::timing_record {};
+      mPreparePerfCounts.clear();
+      auto rtcscene = mScene;
+      auto geometryID = mGeometryID;
+      auto boundaryID = mBoundaryID;
+      auto filterhits = mMultiHitEngine == multi_hit_engine::FILTER;
+      auto& discareas = mDiscAreas;
 
-      auto geohitc = 0ull;
-      auto nongeohitc = 0ull;
-      auto hitAccumulator = trace::hit_accumulator<numeric_type> {mGeometry.get_num_primitives()};
+      auto boundaryReflection = reflection::specular<numeric_type> {};
 
-      #pragma omp declare \
-        reduction(hit_accumulator_combine : \
-                  trace::hit_accumulator<numeric_type> : \
-                  omp_out = trace::hit_accumulator<numeric_type>(omp_out, omp_in)) \
-        initializer(omp_priv = trace::hit_accumulator<numeric_type>(omp_orig))
+      // The rays are partitioned statically among the threads. Every thread
+      // traces its share in epochs of raysperepoch rays; the accumulators of
+      // the threads are reduced epoch by epoch (see trace::epoch_reducer).
+      // Without checkpoints the whole share is one epoch.
+      auto numprims = mGeometry.get_num_primitives();
+      auto numthreads = (size_t) omp_get_max_threads();
+      auto snapshots = mSnapshotCallback && (mSnapshotRays > 0 || mSnapshotSeconds > 0);
+      auto snapshotrays = snapshots && mSnapshotRays > 0
+        ? std::max<size_t>(mSnapshotRays / numthreads, 1)
+        : 0;
+      auto timetriggered = (snapshots && mSnapshotSeconds > 0) || mProgressCallback;
+      // The epochs end at the checkpoints and at the ray-triggered snapshots;
+      // the time-triggered snapshots and progress reports are taken at the end
+      // of short epochs.
+      auto raysperepoch = mCheckpointRays;
+      for (auto rays : {snapshotrays, timetriggered ? sSnapshotEpochRays : 0}) {
+        if (rays > 0 && (raysperepoch == 0 || rays < raysperepoch)) {
+          raysperepoch = rays;
+        }
+      }
+      if (mResume) {
+        numthreads = mResume->hh.numthreads;
+        raysperepoch = mResume->hh.raysperepoch;
+      }
+      // Thread 0 has the largest share
+      auto maxshare = get_thread_share(0, numthreads);
+      if (raysperepoch == 0 || raysperepoch > maxshare) {
+        raysperepoch = std::max<size_t>(maxshare, 1);
+      }
+      auto numepochs = std::max<size_t>((maxshare + raysperepoch - 1) / raysperepoch, 1);
+      auto reducer = trace::epoch_reducer<numeric_type> {numprims, numthreads};
+      if (mResume) {
+        reducer.restore(std::move(mResume->acc), mResume->hh.numepochs, std::move(mResume->progress));
+        mResume.reset();
+      }
+      auto firstepoch = reducer.get_num_epochs();
+      auto firstrays = (size_t) 0;
+      for (size_t idx = 0; idx < numthreads; ++idx) {
+        firstrays += reducer.get_progress(idx).raysdone;
+      }
+      auto budgetns = (uint64_t) (mTimeBudget * 1e9);
+      // The callback of the reducer runs for one epoch at a time
+      auto snapshottimer = util::timer {};
+      auto progresstimer = util::timer {};
+      if ( ! mCheckpointFile.empty() || snapshots || mProgressCallback) {
+        reducer.set_on_epoch
+          ([&, raysperepoch, snapshotrays]
+           (uint64_t pEpochs,
+            trace::hit_accumulator<numeric_type>& pAcc,
+            std::vector<trace::thread_progress> const& pProgress) {
+            // Whether the rays per thread passed a multiple of pRays in this epoch
+            auto passed = [&](size_t pRays) {
+              return pRays > 0 && (pEpochs * raysperepoch) / pRays > ((pEpochs - 1) * raysperepoch) / pRays;
+            };
+            if ( ! mCheckpointFile.empty() && passed(mCheckpointRays) &&
+                 ! io::checkpoint_format::write(mCheckpointFile, mNumRays, raysperepoch, pEpochs, pAcc, pProgress)) {
+              // Not through the logger, whose warnings are off by default: the
+              // run would silently have no restart point. Checkpoints are rare.
+              std::cerr
+                << "Warning: could not write the checkpoint " << mCheckpointFile
+                << "; the run cannot be resumed from this point" << std::endl;
+            }
+            auto numrays = (size_t) 0;
+            for (auto const& pp : pProgress) {
+              numrays += pp.raysdone;
+            }
+            if (snapshots &&
+                (passed(snapshotrays) ||
+                 (mSnapshotSeconds > 0 && snapshottimer.elapsed_seconds() >= mSnapshotSeconds))) {
+              snapshottimer.restart();
+              auto snapshot = std::make_unique<trace::hit_accumulator<numeric_type> >(pAcc);
+              snapshot->set_exposed_areas(discareas);
+              mSnapshotCallback(std::move(snapshot), numrays);
+            }
+            if (mProgressCallback && progresstimer.elapsed_seconds() >= mProgressSeconds) {
+              progresstimer.restart();
+              auto report = trace::progress_report {};
+              report.numRays = numrays;
+              report.raysPerSecond = (numrays - firstrays) / runtimer.elapsed_seconds();
+              report.relativeError = trace::progress_report::get_mean_relative_error(pAcc);
+              mProgressCallback(report);
+            }
+          });
+      }
 
       // The random number generator itself is stateless (has no members which
       // are modified). Hence, it may be shared by threads.
       // auto rng = std::make_unique<rng::cstdlib_rng>();
       auto rng = rng::mt64_rng {};
 
+      // The NUMA node of every thread and the duration of its ray loop
+      auto const& topology = util::numa_topology::get();
+      auto runtimebinds = omp_get_proc_bind() != omp_proc_bind_false;
+      auto replicate = mNumaReplication && ! filterhits;
+      if (replicate && mNodeTables.size() != topology.get_num_nodes()) {
+        mNodeTables.clear();
+        mNodeTables.resize(topology.get_num_nodes());
+      }
+      auto nodetablesonce = std::vector<std::once_flag> (mNodeTables.size());
+      auto threadnodes = std::vector<size_t> (numthreads, 0);
+      auto threadrays = std::vector<size_t> (numthreads, 0);
+      auto threadseconds = std::vector<double> (numthreads, 0);
+
       // Start timing
       auto timer = util::timer {};
+      // Time stamps relative to the start of the timer; set by the master thread
+      auto raysdonens = 0ull;
 
-      #pragma omp parallel \
-        reduction(+ : geohitc, nongeohitc) \
-        reduction(hit_accumulator_combine : hitAccumulator)
+      #pragma omp parallel num_threads(numthreads)
       {
         // Thread local data goes here, if it is not needed anymore after the execution
         // of the parallel region.
@@ -133,14 +490,47 @@ namespace rti { namespace trace {
         // 115249
         // 2147483647
         // 1442968193
-        auto seed = (unsigned int) ((omp_get_thread_num() + 1) *  31); // multiply by magic number (prime)
-        auto rngstate1 = rng::mt64_rng::state { seed + 0 };
-        auto rngstate2 = rng::mt64_rng::state { seed + 1 };
-        auto rngstate3 = rng::mt64_rng::state { seed + 2 };
-        auto rngstate4 = rng::mt64_rng::state { seed + 3 };
-        auto rngstate5 = rng::mt64_rng::state { seed + 4 };
-        auto rngstate6 = rng::mt64_rng::state { seed + 5 };
-        auto rngstate7 = rng::mt64_rng::state { seed + 6 };
+        auto threadnum = (size_t) omp_get_thread_num();
+        assert(omp_get_num_threads() == (int) numthreads && "Correctness Assumption");
+        // Before the thread touches its memory; unpinned at the end of the
+        // parallel region
+        auto pin = std::unique_ptr<util::scoped_thread_pin> {};
+        if (mPinThreads && ! runtimebinds) {
+          pin = std::make_unique<util::scoped_thread_pin>(topology.get_cpu_of_thread(threadnum, numthreads));
+        }
+        auto node = topology.get_current_node();
+        threadnodes[threadnum] = node;
+        auto tables = (geo::disc_side_tables<numeric_type> const*) nullptr;
+        if (replicate) {
+          // The first thread of a node copies the tables of the node
+          std::call_once(nodetablesonce[node], [&] {
+              if (mNodeTables[node] == nullptr) {
+                mNodeTables[node] = std::make_unique<geo::disc_side_tables<numeric_type> >(mGeometry);
+              }
+            });
+          tables = mNodeTables[node].get();
+        }
+        auto progress = reducer.get_progress(threadnum);
+        if (firstepoch == 0) {
+          auto seed = (unsigned int) ((threadnum + 1) *  31); // multiply by magic number (prime)
+          seed += mRngStream << sRngStreamShift;
+          for (size_t idx = 0; idx < progress.rngstates.size(); ++idx) {
+            progress.rngstates[idx] = rng::mt64_rng::state { seed + (unsigned int) idx };
+          }
+        }
+        auto& rngstate1 = progress.rngstates[0];
+        auto& rngstate2 = progress.rngstates[1];
+        auto& rngstate3 = progress.rngstates[2];
+        auto& rngstate4 = progress.rngstates[3];
+        auto& rngstate5 = progress.rngstates[4];
+        auto& rngstate6 = progress.rngstates[5];
+        auto& rngstate7 = progress.rngstates[6];
+        auto& geohitc = progress.hitc;
+        auto& nongeohitc = progress.nonhitc;
+        auto& reflectc = progress.reflectc;
+        auto share = get_thread_share(threadnum, numthreads);
+        auto firstray = get_thread_first_ray(threadnum, numthreads);
+        auto acc = std::make_unique<trace::hit_accumulator<numeric_type> >(numprims);
 
         // A dummy counter for the boundary
         auto boundaryCntr = trace::dummy_counter {};
@@ -152,51 +542,143 @@ namespace rti { namespace trace {
         // probabilistic weight
         auto rayweight = (numeric_type) 1;
 
-        auto rtccontext = RTCIntersectContext {};
-        rtcInitIntersectContext(&rtccontext);
+        auto collector = trace::multi_hit_collector<numeric_type> {};
+        collector.set_max_eps(mMaxMultiHitEps);
+        auto mhcontext = multi_hit_context {RTCIntersectContext {}, &collector};
+        rtcInitIntersectContext(&mhcontext.rtccontext);
 
         size_t progresscnt = 0;
 
-        #pragma omp for
-        for (size_t idx = 0; idx < (unsigned long long int) mNumRays; ++idx) {      
-          particle.init_new();
-          rayweight = get_init_ray_weight();
-          auto lastinitRW = rayweight;
-          mSource.fill_ray(rayhit.ray, rng, rngstate1, rngstate2, rngstate3, rngstate4); // fills also tnear
-          RAYSRCLOG(rayhit);
-          if_RLOG_PROGRESS_is_set_print_progress(progresscnt, mNumRays);
-          auto reflect = false;
-          do {
-            RLOG_DEBUG
-              << "preparing ray == ("
-              << rayhit.ray.org_x << " " << rayhit.ray.org_y << " " << rayhit.ray.org_z
-              << ") ("
-              << rayhit.ray.dir_x << " " << rayhit.ray.dir_y << " " << rayhit.ray.dir_z
-              << ")" << std::endl;
-            rayhit.ray.tfar = std::numeric_limits<float>::max(); // Embree uses float
-            rayhit.hit.instID[0] = RTC_INVALID_GEOMETRY_ID;
-            rayhit.hit.geomID = RTC_INVALID_GEOMETRY_ID;
-            rayhit.ray.tnear = 1e-4; // tnear is also set in the particle source
-            // Run the intersection
-            rtcIntersect1(rtcscene, &rtccontext, &rayhit);
-
-            RAYLOG(rayhit, rayhit.ray.tfar);
-            if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID) {
-              // No  hit
-              nongeohitc += 1;
-              reflect = false;
-              RLOG_TRACE << "i";
-              break; // break do-while loop
+        auto perfgroup = new_perf_counter_group_if_enabled();
+        if (perfgroup) perfgroup->start();
+
+        // Set at the deadline (see set_time_budget()) or on cancellation
+        auto stopped = false;
+        auto looptimer = util::timer {};
+        auto looprays = progress.raysdone;
+        for (auto epoch = firstepoch; epoch < numepochs && ! stopped; ++epoch) {
+          auto epochend = std::min<size_t>(share, (epoch + 1) * raysperepoch);
+          for (; progress.raysdone < epochend; ++progress.raysdone) {
+            if (progress.raysdone % sStopCheckRays == 0 &&
+                (mCancellationToken.is_cancelled() ||
+                 (budgetns > 0 && runtimer.elapsed_nanoseconds() >= budgetns))) {
+              stopped = true;
+              break;
             }
-            // else
-            // A hit
-            if (rayhit.hit.geomID == boundaryID) {
-              // // Ray hit the boundary
-              // reflect = true;
-              // auto orgdir = boundaryReflection.use (rayhit.ray, rayhit.hit, mBoundary, rng, rngstate2);
+            auto idx = firstray + progress.raysdone;
+            particle.init_new();
+            rayweight = get_init_ray_weight();
+            auto lastinitRW = rayweight;
+            mSource.fill_ray(rayhit.ray, rng, rngstate1, rngstate2, rngstate3, rngstate4); // fills also tnear
+            RAYLOG_BEGIN(idx);
+            RAYSRCLOG(rayhit);
+            if_RLOG_PROGRESS_is_set_print_progress(progresscnt, mNumRays);
+            auto reflect = false;
+            do {
+              RLOG_DEBUG
+                << "preparing ray == ("
+                << rayhit.ray.org_x << " " << rayhit.ray.org_y << " " << rayhit.ray.org_z
+                << ") ("
+                << rayhit.ray.dir_x << " " << rayhit.ray.dir_y << " " << rayhit.ray.dir_z
+                << ")" << std::endl;
+              rayhit.ray.tfar = std::numeric_limits<float>::max(); // Embree uses float
+              rayhit.hit.instID[0] = RTC_INVALID_GEOMETRY_ID;
+              rayhit.hit.geomID = RTC_INVALID_GEOMETRY_ID;
+              rayhit.ray.tnear = 1e-4; // tnear is also set in the particle source
+              auto wall = geo::boundary_x_y<numeric_type>::wall::NONE;
+              if (mAnalyticBoundary) {
+                rayhit.ray.tfar = std::min(rayhit.ray.tfar, (float) mBoundary.distance_to_wall(rayhit.ray, wall));
+              }
+              // Run the intersection
+              collector.clear();
+              rtcIntersect1(rtcscene, &mhcontext.rtccontext, &rayhit);
+              if (filterhits) {
+                use_closest_collected_hit(rayhit, collector, geometryID, boundaryID);
+              }
+
+              RAYLOG(rayhit);
+              if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID &&
+                  wall != geo::boundary_x_y<numeric_type>::wall::NONE) {
+                // No hit before the wall; tfar is still the distance to the wall
+                mBoundary.process_wall_hit(rayhit.ray, wall, rayhit.ray.tfar);
+                reflect = true;
+                RLOG_TRACE << "b";
+                continue;
+              }
+              if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID) {
+                // No  hit
+                nongeohitc += 1;
+                reflect = false;
+                RLOG_TRACE << "i";
+                break; // break do-while loop
+              }
+              // else
+              // A hit
+              if (rayhit.hit.geomID == boundaryID) {
+                // // Ray hit the boundary
+                // reflect = true;
+                // auto orgdir = boundaryReflection.use (rayhit.ray, rayhit.hit, mBoundary, rng, rngstate2);
               
-              reflect = true;
-              auto orgdir = mBoundary.process_hit(rayhit.ray, rayhit.hit);
+                reflect = true;
+                auto orgdir = mBoundary.process_hit(rayhit.ray, rayhit.hit);
+                // TODO: optimize
+                rayhit.ray.org_x = orgdir[0][0];
+                rayhit.ray.org_y = orgdir[0][1];
+                rayhit.ray.org_z = orgdir[0][2];
+                rayhit.ray.dir_x = orgdir[1][0];
+                rayhit.ray.dir_y = orgdir[1][1];
+                rayhit.ray.dir_z = orgdir[1][2];
+                RLOG_TRACE << "b";
+                continue;
+              } 
+              assert (rayhit.hit.geomID == geometryID && "Correctness Assumption");
+
+              // If the dot product of the ray direction and the surface normal is greater than zero, then
+              // we hit the back face of the disc.
+              auto const& ray = rayhit.ray;
+              auto const& hit = rayhit.hit;
+              auto const& hitnormal = tables
+                ? tables->get_normal_ref(hit.primID)
+                : mGeometry.get_normal_ref(hit.primID);
+              if (rti::util::dot_product(rti::util::triple<numeric_type> {ray.dir_x, ray.dir_y, ray.dir_z},
+                                         hitnormal) > 0) {
+                // Hit from the back
+                RLOG_TRACE << "a";
+                // Let ray through, i.e., continue.
+                reflect = true; // reflect means continue
+                rayhit.ray.org_x = ray.org_x + ray.dir_x * ray.tfar;
+                rayhit.ray.org_y = ray.org_y + ray.dir_y * ray.tfar;
+                rayhit.ray.org_z = ray.org_z + ray.dir_z * ray.tfar;
+                // keep ray direction as it is
+                continue;
+              }
+              RLOG_TRACE << "h";
+              RAYLOG_HIT(rayhit.hit.primID);
+              geohitc += 1;
+              RLOG_DEBUG << "rayhit.hit.primID == " << rayhit.hit.primID << std::endl;
+              RLOG_DEBUG << "prim == " << mGeometry.prim_to_string(rayhit.hit.primID) << std::endl;
+              // auto sticking = particle.process_hit(hit.primID, {ray.dir_x, ray.dir_y, ray.dir_z});
+              auto sticking = particle.get_sticking_probability(rayhit.ray, rayhit.hit, mGeometry, rng, rngstate5);
+              auto valuetodrop = rayweight * sticking;
+              acc->use(rayhit.hit.primID, valuetodrop);
+              if (filterhits) {
+                collector.for_each_additional([&](unsigned int id) { acc->use(id, valuetodrop); });
+              } else if (tables) {
+                check_for_additional_intersections(rayhit.ray, rayhit.hit.primID, *acc, valuetodrop, *tables);
+              } else {
+                check_for_additional_intersections(rayhit.ray, rayhit.hit.primID, *acc, valuetodrop);
+              }
+              rayweight -= valuetodrop;
+              if (rayweight == 0) {
+                break;
+              }
+              reflect = mc::rejection_control<numeric_type>::check_weight_reweight_or_kill
+                (rayweight, lastinitRW, rng, rngstate6);
+              if ( ! reflect ) {
+                break;
+              }
+              reflectc += 1;
+              auto orgdir = surfreflect.use (rayhit.ray, rayhit.hit, mGeometry, rng, rngstate7);
               // TODO: optimize
               rayhit.ray.org_x = orgdir[0][0];
               rayhit.ray.org_y = orgdir[0][1];
@@ -204,106 +686,94 @@ namespace rti { namespace trace {
               rayhit.ray.dir_x = orgdir[1][0];
               rayhit.ray.dir_y = orgdir[1][1];
               rayhit.ray.dir_z = orgdir[1][2];
-              RLOG_TRACE << "b";
-              continue;
-            } 
-            assert (rayhit.hit.geomID == geometryID && "Correctness Assumption");
-
-            // If the dot product of the ray direction and the surface normal is greater than zero, then
-            // we hit the back face of the disc.
-            auto const& ray = rayhit.ray;
-            auto const& hit = rayhit.hit;
-            if (rti::util::dot_product(rti::util::triple<numeric_type> {ray.dir_x, ray.dir_y, ray.dir_z},
-                                       mGeometry.get_normal(hit.primID)) > 0) {
-              // Hit from the back
-              RLOG_TRACE << "a";
-              // Let ray through, i.e., continue.
-              reflect = true; // reflect means continue
-              rayhit.ray.org_x = ray.org_x + ray.dir_x * ray.tfar;
-              rayhit.ray.org_y = ray.org_y + ray.dir_y * ray.tfar;
-              rayhit.ray.org_z = ray.org_z + ray.dir_z * ray.tfar;
-              // keep ray direction as it is
-              continue;
-            }
-            RLOG_TRACE << "h";
-            geohitc += 1;
-            RLOG_DEBUG << "rayhit.hit.primID == " << rayhit.hit.primID << std::endl;
-            RLOG_DEBUG << "prim == " << mGeometry.prim_to_string(rayhit.hit.primID) << std::endl;
-            // auto sticking = particle.process_hit(hit.primID, {ray.dir_x, ray.dir_y, ray.dir_z});
-            auto sticking = particle.get_sticking_probability(rayhit.ray, rayhit.hit, mGeometry, rng, rngstate5);
-            auto valuetodrop = rayweight * sticking;
-            hitAccumulator.use(rayhit.hit.primID, valuetodrop);
-            check_for_additional_intersections(rayhit.ray, rayhit.hit.primID, hitAccumulator, valuetodrop);
-            rayweight -= valuetodrop;
-            if (rayweight == 0) {
-              break;
-            }
-            reflect = mc::rejection_control<numeric_type>::check_weight_reweight_or_kill
-              (rayweight, lastinitRW, rng, rngstate6);
-            if ( ! reflect ) {
-              break;
-            }
-            auto orgdir = surfreflect.use (rayhit.ray, rayhit.hit, mGeometry, rng, rngstate7);
-            // TODO: optimize
-            rayhit.ray.org_x = orgdir[0][0];
-            rayhit.ray.org_y = orgdir[0][1];
-            rayhit.ray.org_z = orgdir[0][2];
-            rayhit.ray.dir_x = orgdir[1][0];
-            rayhit.ray.dir_y = orgdir[1][1];
-            rayhit.ray.dir_z = orgdir[1][2];
-
-            // // ATTENTION tnear is set in another function, too! When the ray starts from the source, then
-            // // the source class also sets tnear!
-            // auto tnear = 1e-4f; // float
-            // // Same holds for time
-            // auto time = 0.0f; // float
-            // // reinterpret_cast<__m128&>(rayhit.ray) = _mm_load_ps(vara);
-            // // reinterpret_cast<__m128&>(rayhit.ray.dir_x) = _mm_load_ps(varb);
-
-            // // For the store-forwarding stall also see the following link:
-            // // https://stackoverflow.com/questions/49265634/what-is-the-difference-between-loadu-ps-and-set-ps-when-using-unformatted-data
-            // // OPTIMIZATION: It might be better to change the memory layout of the rayout variable
-            // // such that tnear (a constant) is saved right in front of rayout. Then we can use two
-            // // __m128d _mm_store_sd (__m128d a, __m128d b) to write 128 bits in two chunks of 64 bits
-            // // into the destination.
-            // reinterpret_cast<__m128&>(rayhit.ray) =
-            //   _mm_set_ps(tnear,
-            //              (float) rtiContext->rayout[0][2],
-            //              (float) rtiContext->rayout[0][1],
-            //              (float) rtiContext->rayout[0][0]);
-            // reinterpret_cast<__m128&>(rayhit.ray.dir_x) =
-            //   _mm_set_ps(time,
-            //              (float) rtiContext->rayout[1][2],
-            //              (float) rtiContext->rayout[1][1],
-            //              (float) rtiContext->rayout[1][0]);
-          } while (reflect);
+
+              // // ATTENTION tnear is set in another function, too! When the ray starts from the source, then
+              // // the source class also sets tnear!
+              // auto tnear = 1e-4f; // float
+              // // Same holds for time
+              // auto time = 0.0f; // float
+              // // reinterpret_cast<__m128&>(rayhit.ray) = _mm_load_ps(vara);
+              // // reinterpret_cast<__m128&>(rayhit.ray.dir_x) = _mm_load_ps(varb);
+
+              // // For the store-forwarding stall also see the following link:
+              // // https://stackoverflow.com/questions/49265634/what-is-the-difference-between-loadu-ps-and-set-ps-when-using-unformatted-data
+              // // OPTIMIZATION: It might be better to change the memory layout of the rayout variable
+              // // such that tnear (a constant) is saved right in front of rayout. Then we can use two
+              // // __m128d _mm_store_sd (__m128d a, __m128d b) to write 128 bits in two chunks of 64 bits
+              // // into the destination.
+              // reinterpret_cast<__m128&>(rayhit.ray) =
+              //   _mm_set_ps(tnear,
+              //              (float) rtiContext->rayout[0][2],
+              //              (float) rtiContext->rayout[0][1],
+              //              (float) rtiContext->rayout[0][0]);
+              // reinterpret_cast<__m128&>(rayhit.ray.dir_x) =
+              //   _mm_set_ps(time,
+              //              (float) rtiContext->rayout[1][2],
+              //              (float) rtiContext->rayout[1][1],
+              //              (float) rtiContext->rayout[1][0]);
+            } while (reflect);
+            RAYLOG_END();
+          }
+          // Hand the accumulator of this epoch in and continue with another one
+          acc = reducer.submit(threadnum, epoch, std::move(acc), progress, epoch + 1 < numepochs && ! stopped);
+        }
+        threadrays[threadnum] = progress.raysdone - looprays;
+        threadseconds[threadnum] = looptimer.elapsed_seconds();
+        // Before the barrier such that the counts do not include its spinning
+        if (perfgroup) add_perf_counts(result.perfCounts, "ray-loop", perfgroup->stop());
+        #pragma omp barrier
+        #pragma omp master
+        {
+          raysdonens = timer.elapsed_nanoseconds();
+        }
+      }
+      if (mPinThreads || runtimebinds) {
+        // The threads stayed on their nodes
+        result.raysPerSecondPerNode.assign(topology.get_num_nodes(), 0);
+        for (size_t idx = 0; idx < numthreads; ++idx) {
+          if (threadseconds[idx] > 0) {
+            result.raysPerSecondPerNode[threadnodes[idx]] += threadrays[idx] / threadseconds[idx];
+          }
         }
-        auto discareas = compute_disc_areas(mGeometry, mBoundary);
-        hitAccumulator.set_exposed_areas(discareas);
       }
-      // Assertion: hitAccumulator is reduced to one instance by openmp reduction
+      // Assertion: all the epochs of all the threads have been added
+      auto hitAccumulator = reducer.take_result();
+      hitAccumulator->set_exposed_areas(discareas);
+      auto geohitc = 0ull;
+      auto nongeohitc = 0ull;
+      auto reflectc = 0ull;
+      // Less than mNumRays if the time budget is exhausted or the run is
+      // cancelled
+      result.numRays = 0;
+      result.cancelled = mCancellationToken.is_cancelled();
+      for (size_t idx = 0; idx < numthreads; ++idx) {
+        auto const& progress = reducer.get_progress(idx);
+        result.numRays += progress.raysdone;
+        geohitc += progress.hitc;
+        nongeohitc += progress.nonhitc;
+        reflectc += progress.reflectc;
+      }
 
-      result.timeNanoseconds = timer.elapsed_nanoseconds();
-      result.hitAccumulator = std::make_unique<trace::hit_accumulator<numeric_type> >(hitAccumulator);
+      auto tracens = timer.elapsed_nanoseconds();
+      auto areasns = result.timing.child("exposed-areas").get_nanoseconds();
+      result.timeNanoseconds = areasns + tracens;
+      result.timing.child("ray-loop").add_nanoseconds(raysdonens);
+      result.timing.child("reduce").add_nanoseconds(tracens - raysdonens);
+      result.timing.add_nanoseconds(result.timing.child("scene-commit").get_nanoseconds() + result.timeNanoseconds);
+      result.hitAccumulator = std::move(hitAccumulator);
       result.hitc = geohitc;
       result.nonhitc = nongeohitc;
+      result.reflectc = reflectc;
 
-      rtcReleaseGeometry(rtcgeometry);
-      rtcReleaseGeometry(rtcboundary);
-
-      auto raylog = RAYLOG_GET_PTR();
-      if (raylog != nullptr) {
-        auto raylogfilename = "raylog.vtp";
-        std::cout << "Writing ray log to " << raylogfilename << std::endl;
-        io::vtp_writer<float>::write(raylog, raylogfilename);
-      }
-      auto raysrclog = RAYSRCLOG_GET_PTR();
-      if (raysrclog != nullptr) {
-        auto raysrclogfilename = "raysrclog.vtp";
-        std::cout << "Writing ray src log to " << raysrclogfilename << std::endl;
-        io::vtp_writer<float>::write(raysrclog, raysrclogfilename);
+      // Release the scene (and with it the BVH) but not the geometries. The
+      // geometries belong to their geometry objects and may be traced again.
+      if ( ! mKeepScene) {
+        release_scene();
       }
 
+      // Write what is left in the per-thread buffers of the ray logger
+      util::ray_logger::flush();
+
       // { // Debug
       //   std::cout << "[Alex] V 5" << std::endl;
       //   auto dirpath = std::string {"/home/alexanders/vtk/outputs/current/"};
@@ -331,6 +801,143 @@ namespace rti { namespace trace {
 
   private:
 
+    std::unique_ptr<util::perf_counter_group> new_perf_counter_group_if_enabled()
+    {
+      if ( ! mPerfCounters) {
+        return nullptr;
+      }
+      auto result = std::make_unique<util::perf_counter_group>();
+      if ( ! result->is_valid()) {
+        // Called by every thread of every phase. Not through the logger, whose
+        // warnings are off by default: the counts would just be missing.
+        static std::once_flag warnonce;
+        std::call_once(warnonce, [] {
+            std::cerr
+              << "Warning: hardware performance counters are not available"
+              << " (no PMU, or see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+          });
+        return nullptr;
+      }
+      return result;
+    }
+
+    void add_perf_counts
+    (std::map<std::string, util::perf_counts>& pPerfCounts, std::string const& pPhase, util::perf_counts const& pCounts)
+    {
+      #pragma omp critical (rti_tracer_perf_counts)
+      {
+        pPerfCounts[pPhase] += pCounts;
+      }
+    }
+
+    void release_scene()
+    {
+      if (mScene != nullptr) {
+        rtcReleaseScene(mScene);
+        mScene = nullptr;
+      }
+    }
+
+    // Intersect filter function of the disc geometry (see set_back_face_filter()).
+    // The geometry user data points to mGeometry.
+    static
+    void reject_back_face_hits(RTCFilterFunctionNArguments const* pArgs)
+    {
+      auto& geometry = *static_cast<geo::point_cloud_disc_geometry<numeric_type>*> (pArgs->geometryUserPtr);
+      for (unsigned int idx = 0; idx < pArgs->N; ++idx) {
+        if (pArgs->valid[idx] != -1) {
+          continue; // inactive
+        }
+        auto const& normal = geometry.get_normal_ref(RTCHitN_primID(pArgs->hit, pArgs->N, idx));
+        auto dotp =
+          RTCRayN_dir_x(pArgs->ray, pArgs->N, idx) * normal[0] +
+          RTCRayN_dir_y(pArgs->ray, pArgs->N, idx) * normal[1] +
+          RTCRayN_dir_z(pArgs->ray, pArgs->N, idx) * normal[2];
+        if (dotp > 0) {
+          // Hit from the back; continue the traversal
+          pArgs->valid[idx] = 0;
+        }
+      }
+    }
+
+    // The intersect context of the FILTER multi-hit engine. Embree passes a
+    // pointer to the first member to the filter function.
+    struct multi_hit_context {
+      RTCIntersectContext rtccontext;
+      trace::multi_hit_collector<numeric_type>* collector;
+    };
+
+    // Intersect filter function of the disc geometry for the FILTER multi-hit
+    // engine. Rejects all the hits in range such that the traversal goes on.
+    // A hit beyond the range of any closer hit is accepted; that shortens the
+    // ray.
+    static
+    void collect_front_face_hits(RTCFilterFunctionNArguments const* pArgs)
+    {
+      auto& geometry = *static_cast<geo::point_cloud_disc_geometry<numeric_type>*> (pArgs->geometryUserPtr);
+      auto& collector = *reinterpret_cast<multi_hit_context const*> (pArgs->context)->collector;
+      for (unsigned int idx = 0; idx < pArgs->N; ++idx) {
+        if (pArgs->valid[idx] != -1) {
+          continue; // inactive
+        }
+        auto primID = RTCHitN_primID(pArgs->hit, pArgs->N, idx);
+        auto const& normal = geometry.get_normal_ref(primID);
+        auto dotp =
+          RTCRayN_dir_x(pArgs->ray, pArgs->N, idx) * normal[0] +
+          RTCRayN_dir_y(pArgs->ray, pArgs->N, idx) * normal[1] +
+          RTCRayN_dir_z(pArgs->ray, pArgs->N, idx) * normal[2];
+        if (dotp > 0) {
+          pArgs->valid[idx] = 0; // hit from the back
+          continue;
+        }
+        // The hits within the diameter of the closest disc along the ray.
+        // This approximates check_for_additional_intersections(), which tests
+        // the overlap of the discs instead. See also get_max_multi_hit_eps().
+        auto eps = 2 * geometry.get_prim_ref(primID)[3];
+        if (collector.add(RTCRayN_tfar(pArgs->ray, pArgs->N, idx), primID, eps)) {
+          pArgs->valid[idx] = 0;
+        }
+      }
+    }
+
+    // The largest range of a hit in collect_front_face_hits(). The filter
+    // function may shorten a ray only beyond this range of the closest hit.
+    numeric_type get_max_multi_hit_eps()
+    {
+      auto result = (numeric_type) 0;
+      for (size_t idx = 0; idx < mGeometry.get_num_primitives(); ++idx) {
+        result = std::max(result, 2 * mGeometry.get_prim_ref(idx)[3]);
+      }
+      return result;
+    }
+
+    // Turns the closest collected hit into the hit of pRayHit unless the
+    // boundary is closer.
+    void use_closest_collected_hit
+    (RTCRayHit& pRayHit,
+     trace::multi_hit_collector<numeric_type> const& pCollector,
+     unsigned int pGeometryID,
+     unsigned int pBoundaryID)
+    {
+      if (pCollector.empty()) {
+        assert(pRayHit.hit.geomID != pGeometryID && "Correctness Assumption");
+        return;
+      }
+      auto const& closest = pCollector.get_closest();
+      // With the analytic boundary, pBoundaryID is RTC_INVALID_GEOMETRY_ID,
+      // which is also the geomID of a miss.
+      if ( ! mAnalyticBoundary && pRayHit.hit.geomID == pBoundaryID && pRayHit.ray.tfar < closest.tfar) {
+        return;
+      }
+      auto const& normal = mGeometry.get_normal_ref(closest.primID);
+      pRayHit.ray.tfar = closest.tfar;
+      pRayHit.hit.geomID = pGeometryID;
+      pRayHit.hit.primID = closest.primID;
+      pRayHit.hit.Ng_x = normal[0];
+      pRayHit.hit.Ng_y = normal[1];
+      pRayHit.hit.Ng_z = normal[2];
+    }
+
     constexpr numeric_type get_init_ray_weight()
     {
       return 1;
@@ -381,11 +988,42 @@ namespace rti { namespace trace {
       //   std::cout << std::endl;
       // }
     }
+
+    // Same as above with the copy of the side tables of the NUMA node of the
+    // calling thread (see set_numa_replication())
+    void check_for_additional_intersections
+    (RTCRay& ray,
+     unsigned int hit1id,
+     trace::hit_accumulator<numeric_type>& hitAcc,
+     numeric_type valuetodrop,
+     geo::disc_side_tables<numeric_type> const& tables)
+    {
+      for (auto id : tables.get_neighbors(hit1id)) {
+        if (local_intersector::intersect(ray, tables.get_prim_ref(id), tables.get_normal_ref(id))) {
+          hitAcc.use(id, valuetodrop);
+        }
+      }
+    }
       
-    std::vector<numeric_type>
+    // The number of rays which thread pThread out of pNumThreads traces
+    size_t get_thread_share(size_t pThread, size_t pNumThreads)
+    {
+      return mNumRays / pNumThreads + (pThread < mNumRays % pNumThreads ? 1 : 0);
+    }
+
+    // The index of the first ray of thread pThread (see get_thread_share())
+    size_t get_thread_first_ray(size_t pThread, size_t pNumThreads)
+    {
+      return pThread * (mNumRays / pNumThreads) + std::min(pThread, mNumRays % pNumThreads);
+    }
+
+    // Fills areas (of size get_num_primitives()); called by all the threads
+    // of a parallel region.
+    void
     compute_disc_areas
     (geo::point_cloud_disc_geometry<numeric_type>& geometry,
-     geo::boundary_x_y<numeric_type>& boundary)
+     geo::boundary_x_y<numeric_type>& boundary,
+     std::vector<numeric_type>& areas)
     {
       // TODO: Instead of comparing introduce a method boundary.get_bounding_box()
       auto xmin = std::numeric_limits<numeric_type>::max();
@@ -404,17 +1042,21 @@ namespace rti { namespace trace {
       }
       auto dbbi = geo::disc_bounding_box_intersector(xmin, ymin, xmax, ymax);
       auto numofprimitives = geometry.get_num_primitives();
-      auto areas = std::vector<numeric_type> (numofprimitives, 0);
+      assert(areas.size() == numofprimitives && "Precondition");
       #pragma omp for
       for (size_t idx = 0; idx < numofprimitives; ++idx) {
         areas[idx] = dbbi.area_inside(geometry.get_prim_ref(idx), geometry.get_normal_ref(idx));
       }
-      return areas;
     }
 
     void if_RLOG_PROGRESS_is_set_print_progress(size_t& raycnt, size_t const& totalnumrays)
     {
-      if (omp_get_thread_num() != 0) {
+      if ( ! util::logger::is_enabled(util::log_level::PROGRESS) || omp_get_thread_num() != 0) {
+        return;
+      }
+      // No bar for a time budget without a ray limit; the bar would not
+      // move then.
+      if (totalnumrays == std::numeric_limits<size_t>::max()) {
         return;
       }
       auto barlength = 30u;
@@ -424,8 +1066,10 @@ namespace rti { namespace trace {
       auto barendsymbol = ']';
       auto percentagestringformatlength = 3; // 3 digits
 
-      if (raycnt % (int) std::ceil((float) totalnumrays / omp_get_num_threads() / barlength) == 0) {
-        auto filllength = (int) std::ceil(raycnt / ((float)totalnumrays / omp_get_num_threads() / barlength));
+      auto step = std::max((size_t) 1,
+        (size_t) std::ceil((double) totalnumrays / omp_get_num_threads() / barlength));
+      if (raycnt % step == 0) {
+        auto filllength = (unsigned int) std::min((size_t) barlength, raycnt / step);
         auto percentagestring = std::to_string((filllength * 100) / barlength);
         percentagestring =
           std::string(percentagestringformatlength - percentagestring.length(), ' ') +
@@ -449,5 +1093,42 @@ namespace rti { namespace trace {
     geo::boundary_x_y<numeric_type>& mBoundary;
     ray::i_source& mSource;
     size_t mNumRays;
+    bool mPerfCounters = false;
+    bool mAnalyticBoundary = false;
+    bool mBackFaceFilter = false;
+    multi_hit_engine mMultiHitEngine = multi_hit_engine::NEIGHBORHOOD;
+    // The seeds of the threads of one stream are below 2^20 (for less than
+    // 30000 threads); the streams start at multiples of 2^20.
+    static constexpr unsigned int sRngStreamShift = 20;
+    unsigned int mRngStream = 0;
+    std::string mCheckpointFile;
+    // Rays per thread between two checkpoints; 0 if there are no checkpoints
+    size_t mCheckpointRays = 0;
+    std::unique_ptr<io::checkpoint_format::content<numeric_type> > mResume;
+    snapshot_callback mSnapshotCallback;
+    size_t mSnapshotRays = 0;
+    double mSnapshotSeconds = 0;
+    // The rays per thread and epoch if the snapshots are triggered by time
+    // only; short enough that the snapshots are taken on time
+    static constexpr size_t sSnapshotEpochRays = 16 * 1024;
+    double mTimeBudget = 0;
+    // A power of two; one clock read per this many rays is negligible
+    static constexpr size_t sStopCheckRays = 256;
+    util::cancellation_token mCancellationToken;
+    progress_callback mProgressCallback;
+    double mProgressSeconds = 0;
+    bool mKeepScene = false;
+    bool mPinThreads = false;
+    bool mNumaReplication = false;
+    // One copy per NUMA node; see set_numa_replication()
+    std::vector<std::unique_ptr<geo::disc_side_tables<numeric_type> > > mNodeTables;
+    // Set by prepare()
+    RTCScene mScene = nullptr;
+    unsigned int mGeometryID = RTC_INVALID_GEOMETRY_ID;
+    unsigned int mBoundaryID = RTC_INVALID_GEOMETRY_ID;
+    std::vector<numeric_type> mDiscAreas;
+    numeric_type mMaxMultiHitEps = 0;
+    util::timing_record mPrepareTiming;
+    std::map<std::string, util::perf_counts> mPreparePerfCounts;
   };
 }}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+namespace rti { namespace util {
+
+  // A non-owning view of a contiguous array (pointer and size), e.g., of a
+  // std::vector or of a memory mapped file. The viewed memory has to outlive
+  // the view.
+  template<typename element_type>
+  class array_view {
+  public:
+    array_view() = default;
+
+    array_view(element_type* pData, size_t pSize) :
+      mData(pData),
+      mSize(pSize) {}
+
+    // Views the elements of a container with data() and size() (e.g., a std::vector)
+    template<typename container_type,
+             typename = decltype(static_cast<element_type*>(std::declval<container_type&>().data()))>
+    array_view(container_type& pContainer) :
+      mData(pContainer.data()),
+      mSize(pContainer.size()) {}
+
+    element_type& operator[](size_t pIdx) const
+    {
+      assert(pIdx < mSize && "Index out of bounds");
+      return mData[pIdx];
+    }
+
+    element_type* data() const
+    {
+      return mData;
+    }
+
+    size_t size() const
+    {
+      return mSize;
+    }
+
+    bool empty() const
+    {
+      return mSize == 0;
+    }
+
+    element_type* begin() const
+    {
+      return mData;
+    }
+
+    element_type* end() const
+    {
+      return mData + mSize;
+    }
+
+  private:
+    element_type* mData = nullptr;
+    size_t mSize = 0;
+  };
+}} // namespace
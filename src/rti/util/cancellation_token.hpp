@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace rti { namespace util {
+
+  // Lets one thread ask a computation running on other threads to stop (e.g.,
+  // tracer::run()). Copies share the same state; the computation polls
+  // is_cancelled() at points where it can stop cleanly.
+  class cancellation_token {
+  public:
+    cancellation_token() :
+      mCancelled(std::make_shared<std::atomic<bool> >(false)) {}
+
+    void cancel()
+    {
+      mCancelled->store(true, std::memory_order_relaxed);
+    }
+
+    bool is_cancelled() const
+    {
+      return mCancelled->load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::shared_ptr<std::atomic<bool> > mCancelled;
+  };
+}} // namespace
@@ -1,56 +1,288 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 // An effective logger
+//
+// The log levels and the destination (sink) of the logger are set at runtime.
+// A disabled log level costs a single (predictable) branch: the macros below
+// expand to an if-else statement such that the arguments of a disabled log
+// statement are not even evaluated.
+//
+// Every log statement is formatted into a buffer of its own. When the
+// statement ends, the message is appended to a queue of the calling thread
+// which a background writer thread drains into the sink. Hence, tracing
+// threads never wait on the sink and do not share a lock with each other.
+// The messages of one thread keep their order; the messages of different
+// threads may be interleaved in any order.
 
 namespace rti { namespace util {
-// Set the log level by commenting the following lines out
-//
-#define RLOG_LEVEL_INFO
-//#define RLOG_LEVEL_TRACE
-//#define RLOG_LEVEL_DEBUG
-//#define RLOG_LEVEL_WARNING
-//#define RLOG_LEVEL_ERROR
-#define RLOG_LEVEL_PROGRESS
-
-  // Set the logging destination here
-  static std::ostream& sLStream = std::cerr;
-
-#ifdef RLOG_LEVEL_INFO
-#define RLOG_INFO rti::util::sLStream
-#else
-#define RLOG_INFO if (true) {} else rti::util::sLStream << "[info] "
-#endif
-
-#ifdef RLOG_LEVEL_TRACE
-#define RLOG_TRACE rti::util::sLStream
-#else
-#define RLOG_TRACE if (true) {} else rti::util::sLStream
-#endif
-
-#ifdef RLOG_LEVEL_DEBUG
-#define RLOG_DEBUG rti::util::sLStream
-#else
-#define RLOG_DEBUG if (true) {} else rti::util::sLStream
-#endif
-
-#ifdef RLOG_LEVEL_WARNING
-#define RLOG_WARNING rti::util::sLStream
-#else
-#define RLOG_WARNING if (true) {} else rti::util::sLStream
-#endif
-
-#ifdef RLOG_LEVEL_ERROR
-#define RLOG_ERROR rti::util::sLStream
-#else
-#define RLOG_ERROR if (true) {} else rti::util::sLStream
-#endif
-
-#ifdef RLOG_LEVEL_PROGRESS
-#define RLOG_PROGRESS rti::util::sLStream
-#else
-#define RLOG_PROGRESS if (true) {} else rti::util::sLStream
-#endif
+
+  // The log levels are bit flags; they can be combined freely.
+  namespace log_level {
+    static constexpr uint32_t NONE = 0;
+    static constexpr uint32_t TRACE = 1 << 0;
+    static constexpr uint32_t DEBUG = 1 << 1;
+    static constexpr uint32_t INFO = 1 << 2;
+    static constexpr uint32_t WARNING = 1 << 3;
+    static constexpr uint32_t ERROR = 1 << 4;
+    static constexpr uint32_t PROGRESS = 1 << 5;
+    static constexpr uint32_t ALL = (1 << 6) - 1;
+  }
+
+  class logger {
+
+  public:
+
+    static
+    bool is_enabled(uint32_t pLevel)
+    {
+      return __builtin_expect((sLevels.load(std::memory_order_relaxed) & pLevel) != 0, 0);
+    }
+
+    static
+    void set_levels(uint32_t pLevels)
+    {
+      sLevels.store(pLevels, std::memory_order_relaxed);
+    }
+
+    static
+    uint32_t get_levels()
+    {
+      return sLevels.load(std::memory_order_relaxed);
+    }
+
+    // Parses a comma separated list of level names (e.g., "info,progress").
+    // Returns false if the string contains an unknown name; in that case the
+    // levels remain unchanged.
+    static
+    bool set_levels(std::string const& pLevels)
+    {
+      auto levels = log_level::NONE;
+      auto stream = std::stringstream {pLevels};
+      for (auto name = std::string {}; std::getline(stream, name, ',');) {
+        if (name == "none") continue;
+        else if (name == "trace") levels |= log_level::TRACE;
+        else if (name == "debug") levels |= log_level::DEBUG;
+        else if (name == "info") levels |= log_level::INFO;
+        else if (name == "warning") levels |= log_level::WARNING;
+        else if (name == "error") levels |= log_level::ERROR;
+        else if (name == "progress") levels |= log_level::PROGRESS;
+        else if (name == "all") levels |= log_level::ALL;
+        else return false;
+      }
+      set_levels(levels);
+      return true;
+    }
+
+    // The sink has to outlive the logger or has to be replaced before it is
+    // destroyed.
+    static
+    void set_sink(std::ostream& pSink)
+    {
+      auto& ll = instance();
+      auto lock = ll.wait_until_written();
+      ll.mSink->flush();
+      ll.mSink = &pSink;
+    }
+
+    // Blocks until all the messages which have been handed to the writer are
+    // written to the sink.
+    static
+    void flush()
+    {
+      auto& ll = instance();
+      auto lock = ll.wait_until_written();
+      ll.mSink->flush();
+    }
+
+    // Hands a formatted message to the background writer
+    static
+    void submit(std::string&& pMsg)
+    {
+      auto& ll = instance();
+      auto& queue = ll.get_thread_queue();
+      {
+        // Contended by the writer only
+        auto lock = std::lock_guard<std::mutex> {queue.mMutex};
+        queue.mMsgs.push_back(std::move(pMsg));
+      }
+      ll.mSubmitted.fetch_add(1, std::memory_order_release);
+      // Without the lock of the writer a wakeup may be missed; the writer
+      // polls in that case (see sPollInterval).
+      ll.mPending.notify_one();
+    }
+
+    ~logger()
+    {
+      {
+        auto lock = std::lock_guard<std::mutex> {mMutex};
+        mStop = true;
+      }
+      mPending.notify_one();
+      if (mWriter.joinable()) {
+        mWriter.join();
+      }
+    }
+
+  private:
+
+    // The messages of one thread which the writer has not taken yet
+    struct thread_queue {
+      std::mutex mMutex;
+      std::vector<std::string> mMsgs;
+    };
+
+    logger() :
+      mWriter([this] { write_loop(); }) {}
+
+    static
+    logger& instance()
+    {
+      static logger sInstance;
+      return sInstance;
+    }
+
+    // Registers the queue of the calling thread on its first message
+    thread_queue& get_thread_queue()
+    {
+      thread_local auto tQueue = std::shared_ptr<thread_queue> {};
+      if ( ! tQueue) {
+        tQueue = std::make_shared<thread_queue>();
+        auto lock = std::lock_guard<std::mutex> {mMutex};
+        mQueues.push_back(tQueue);
+      }
+      return *tQueue;
+    }
+
+    // Returns the lock of the logger once all the messages submitted so far
+    // are written
+    std::unique_lock<std::mutex> wait_until_written()
+    {
+      auto target = mSubmitted.load(std::memory_order_acquire);
+      auto lock = std::unique_lock<std::mutex> {mMutex};
+      mPending.notify_one();
+      mDone.wait(lock, [this, target] { return mWritten >= target && ! mWriting; });
+      return lock;
+    }
+
+    void write_loop()
+    {
+      auto lock = std::unique_lock<std::mutex> {mMutex};
+      auto batch = std::vector<std::string> {};
+      while (true) {
+        mPending.wait_for(lock, sPollInterval, [this] {
+            return mStop || mSubmitted.load(std::memory_order_acquire) > mWritten;
+          });
+        for (auto& queue : mQueues) {
+          auto queuelock = std::lock_guard<std::mutex> {queue->mMutex};
+          for (auto& msg : queue->mMsgs) {
+            batch.push_back(std::move(msg));
+          }
+          queue->mMsgs.clear();
+        }
+        // Drop the drained queues of threads which have exited
+        for (size_t idx = 0; idx < mQueues.size();) {
+          if (mQueues[idx].use_count() == 1) {
+            mQueues[idx] = std::move(mQueues.back());
+            mQueues.pop_back();
+          } else {
+            ++idx;
+          }
+        }
+        if (batch.empty()) {
+          if (mStop) {
+            mSink->flush();
+            return;
+          }
+          continue;
+        }
+        auto sink = mSink;
+        mWriting = true;
+        lock.unlock();
+        for (auto const& msg : batch) {
+          *sink << msg;
+        }
+        sink->flush();
+        lock.lock();
+        mWritten += batch.size();
+        batch.clear();
+        mWriting = false;
+        mDone.notify_all();
+      }
+    }
+
+    inline static std::atomic<uint32_t> sLevels {log_level::INFO | log_level::PROGRESS};
+    // The longest delay of a message whose wakeup of the writer was missed
+    static constexpr auto sPollInterval = std::chrono::milliseconds {10};
+
+    std::mutex mMutex;
+    std::condition_variable mPending;
+    std::condition_variable mDone;
+    std::vector<std::shared_ptr<thread_queue> > mQueues;
+    std::atomic<uint64_t> mSubmitted {0};
+    uint64_t mWritten = 0;
+    std::ostream* mSink = &std::cerr;
+    bool mWriting = false;
+    bool mStop = false;
+    std::thread mWriter;
+  };
+
+  // A temporary which collects one log statement in a buffer and submits it
+  // to the logger when the statement ends. A log statement may be evaluated
+  // within the arguments of another one.
+  class log_statement {
+  public:
+    log_statement() = default;
+
+    log_statement(log_statement const&) = delete;
+    log_statement& operator=(log_statement const&) = delete;
+
+    ~log_statement()
+    {
+      auto msg = mBuffer.str();
+      if ( ! msg.empty()) {
+        logger::submit(std::move(msg));
+      }
+    }
+
+    template<typename T>
+    log_statement& operator<<(T const& pValue)
+    {
+      mBuffer << pValue;
+      return *this;
+    }
+
+    // Stream manipulators such as std::endl
+    log_statement& operator<<(std::ostream& (*pManipulator) (std::ostream&))
+    {
+      mBuffer << pManipulator;
+      return *this;
+    }
+
+  private:
+    std::ostringstream mBuffer;
+  };
+
+// These macros expect a semicolon at the end
+#define RLOG_LEVEL(level) \
+  if ( ! rti::util::logger::is_enabled(level)) {} else rti::util::log_statement {}
+
+#define RLOG_INFO RLOG_LEVEL(rti::util::log_level::INFO)
+#define RLOG_TRACE RLOG_LEVEL(rti::util::log_level::TRACE)
+#define RLOG_DEBUG RLOG_LEVEL(rti::util::log_level::DEBUG)
+#define RLOG_WARNING RLOG_LEVEL(rti::util::log_level::WARNING)
+#define RLOG_ERROR RLOG_LEVEL(rti::util::log_level::ERROR)
+#define RLOG_PROGRESS RLOG_LEVEL(rti::util::log_level::PROGRESS)
 
 }} // namespace
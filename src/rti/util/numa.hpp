@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+
+namespace rti { namespace util {
+
+  // The NUMA nodes (sockets) of the machine and the CPUs of every node which
+  // this process may run on (its affinity mask). Read from
+  // /sys/devices/system/node on Linux; a single node if that is not
+  // available. No dependency on libnuma.
+  //
+  // The threads of a parallel region are assigned to the nodes in contiguous
+  // blocks of (almost) equal size and, within a node, to its CPUs in
+  // ascending order (see get_cpu_of_thread()). Hence, thread t runs on the
+  // same CPU in every run with the same number of threads, and memory which
+  // it touches first stays local.
+  class numa_topology {
+  public:
+    // pNodeCpus holds the CPUs of every node; nodes without CPUs are dropped
+    numa_topology(std::vector<std::vector<int> > pNodeCpus)
+    {
+      for (auto& cpus : pNodeCpus) {
+        if ( ! cpus.empty()) {
+          std::sort(cpus.begin(), cpus.end());
+          mNodeCpus.push_back(std::move(cpus));
+        }
+      }
+    }
+
+    // The topology of this machine and process; detected on the first call
+    static
+    numa_topology const& get()
+    {
+      static auto const topology = detect();
+      return topology;
+    }
+
+    size_t get_num_nodes() const
+    {
+      return mNodeCpus.size();
+    }
+
+    std::vector<int> const& get_cpus(size_t pNode) const
+    {
+      return mNodeCpus[pNode];
+    }
+
+    // The node of thread pThread out of pNumThreads
+    size_t get_node_of_thread(size_t pThread, size_t pNumThreads) const
+    {
+      return pThread * get_num_nodes() / pNumThreads;
+    }
+
+    // The CPU of thread pThread out of pNumThreads. If there are more threads
+    // than CPUs on a node, the CPUs are used round robin.
+    int get_cpu_of_thread(size_t pThread, size_t pNumThreads) const
+    {
+      auto node = get_node_of_thread(pThread, pNumThreads);
+      auto firstthread = (node * pNumThreads + get_num_nodes() - 1) / get_num_nodes();
+      auto const& cpus = mNodeCpus[node];
+      return cpus[(pThread - firstthread) % cpus.size()];
+    }
+
+    // The node of pCpu; 0 if the CPU is unknown
+    size_t get_node_of_cpu(int pCpu) const
+    {
+      for (size_t node = 0; node < mNodeCpus.size(); ++node) {
+        if (std::binary_search(mNodeCpus[node].begin(), mNodeCpus[node].end(), pCpu)) {
+          return node;
+        }
+      }
+      return 0;
+    }
+
+    // The node of the CPU the calling thread runs on right now
+    size_t get_current_node() const
+    {
+      return get_node_of_cpu(sched_getcpu());
+    }
+
+    // Restricts the calling thread to pCpu. Returns false on failure.
+    static
+    bool pin_current_thread(int pCpu)
+    {
+      auto set = cpu_set_t {};
+      CPU_ZERO(&set);
+      CPU_SET(pCpu, &set);
+      return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+    // Parses a CPU list of the kernel, e.g., "0-3,8,10-11"
+    static
+    std::vector<int> parse_cpu_list(std::string const& pList)
+    {
+      auto result = std::vector<int> {};
+      auto stream = std::stringstream {pList};
+      for (auto range = std::string {}; std::getline(stream, range, ',');) {
+        try {
+          auto dash = range.find('-');
+          auto first = std::stoi(range.substr(0, dash));
+          auto last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+          for (auto cpu = first; cpu <= last; ++cpu) {
+            result.push_back(cpu);
+          }
+        } catch (...) {} // e.g., an empty list
+      }
+      return result;
+    }
+
+  private:
+    static
+    numa_topology detect()
+    {
+      auto allowed = cpu_set_t {};
+      CPU_ZERO(&allowed);
+      if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return numa_topology {{{0}}};
+      }
+      auto isallowed = [&allowed](int pCpu) {
+        return 0 <= pCpu && pCpu < CPU_SETSIZE && CPU_ISSET(pCpu, &allowed);
+      };
+      auto nodecpus = std::vector<std::vector<int> > {};
+      for (auto node = 0; ; ++node) {
+        auto in = std::ifstream {"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+        if ( ! in) {
+          break;
+        }
+        auto list = std::string {};
+        std::getline(in, list);
+        auto cpus = parse_cpu_list(list);
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](int pCpu) { return ! isallowed(pCpu); }),
+                   cpus.end());
+        nodecpus.push_back(std::move(cpus));
+      }
+      auto topology = numa_topology {std::move(nodecpus)};
+      if (topology.get_num_nodes() == 0) {
+        // No NUMA information; one node with all the allowed CPUs
+        auto cpus = std::vector<int> {};
+        for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+          if (isallowed(cpu)) {
+            cpus.push_back(cpu);
+          }
+        }
+        return numa_topology {{cpus}};
+      }
+      return topology;
+    }
+
+    std::vector<std::vector<int> > mNodeCpus;
+  };
+
+  // Pins the calling thread to a CPU (see numa_topology::pin_current_thread())
+  // and restores its previous affinity mask on destruction. Otherwise, the
+  // caller of a parallel region (the master thread) and every thread it
+  // creates later would stay confined to that CPU.
+  class scoped_thread_pin {
+  public:
+    scoped_thread_pin(int pCpu)
+    {
+      CPU_ZERO(&mSaved);
+      mPinned =
+        sched_getaffinity(0, sizeof(mSaved), &mSaved) == 0 &&
+        numa_topology::pin_current_thread(pCpu);
+    }
+
+    scoped_thread_pin(scoped_thread_pin const&) = delete;
+    scoped_thread_pin& operator=(scoped_thread_pin const&) = delete;
+
+    ~scoped_thread_pin()
+    {
+      if (mPinned) {
+        sched_setaffinity(0, sizeof(mSaved), &mSaved);
+      }
+    }
+
+    bool is_pinned() const
+    {
+      return mPinned;
+    }
+
+  private:
+    cpu_set_t mSaved;
+    bool mPinned = false;
+  };
+}} // namespace
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters based on the Linux perf_event_open(2) system
+// call. A perf_counter_group counts the events of the thread which created it
+// (on any CPU, user space only). All counters of a group are scheduled onto
+// the hardware together; if the kernel has to multiplex them, the counts are
+// scaled by time_enabled / time_running.
+//
+// If the counters are not available (e.g., not Linux, no PMU in a virtual
+// machine, or a restrictive /proc/sys/kernel/perf_event_paranoid) the group is
+// invalid and all counts are zero.
+
+namespace rti { namespace util {
+
+  class perf_counts {
+  public:
+    enum event : size_t {
+      CYCLES = 0,
+      INSTRUCTIONS,
+      CACHE_MISSES,
+      BRANCH_MISSES,
+      DTLB_LOAD_MISSES,
+      NUM_EVENTS
+    };
+
+    static constexpr std::array<char const*, NUM_EVENTS> sNames
+      {"cycles", "instructions", "cache-misses", "branch-misses", "dtlb-load-misses"};
+
+    std::array<uint64_t, NUM_EVENTS> counts {};
+    // Whether the event could be counted
+    std::array<bool, NUM_EVENTS> available {};
+
+    perf_counts& operator+=(perf_counts const& pOther)
+    {
+      for (size_t idx = 0; idx < NUM_EVENTS; ++idx) {
+        counts[idx] += pOther.counts[idx];
+        available[idx] = available[idx] || pOther.available[idx];
+      }
+      return *this;
+    }
+
+    bool any_available() const
+    {
+      for (auto aa : available) {
+        if (aa) return true;
+      }
+      return false;
+    }
+
+    double ipc() const
+    {
+      return counts[CYCLES] == 0 ? 0.0 : (double) counts[INSTRUCTIONS] / counts[CYCLES];
+    }
+
+    // Prints the counts divided by pDivisor (e.g., the number of rays)
+    void print(std::ostream& pOs, double pDivisor = 1) const
+    {
+      for (size_t idx = 0; idx < NUM_EVENTS; ++idx) {
+        pOs << sNames[idx] << "=";
+        if (available[idx]) {
+          pOs << counts[idx] / pDivisor;
+        } else {
+          pOs << "n/a";
+        }
+        pOs << " ";
+      }
+      pOs << "ipc=" << ipc();
+    }
+  };
+
+  class perf_counter_group {
+  public:
+    perf_counter_group()
+    {
+      mFds.fill(-1);
+#ifdef __linux__
+      for (size_t idx = 0; idx < perf_counts::NUM_EVENTS; ++idx) {
+        auto attr = perf_event_attr {};
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        set_event(attr, (perf_counts::event) idx);
+        attr.read_format =
+          PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // Only the leader starts disabled; the members follow the leader.
+        attr.disabled = mLeader == -1 ? 1 : 0;
+        auto fd = (int) syscall(__NR_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, mLeader, 0);
+        if (fd == -1) {
+          continue;
+        }
+        mFds[idx] = fd;
+        ioctl(fd, PERF_EVENT_IOC_ID, &mIds[idx]);
+        if (mLeader == -1) {
+          mLeader = fd;
+        }
+      }
+#endif
+    }
+
+    perf_counter_group(perf_counter_group const&) = delete;
+    perf_counter_group& operator=(perf_counter_group const&) = delete;
+
+    ~perf_counter_group()
+    {
+#ifdef __linux__
+      for (auto fd : mFds) {
+        if (fd != -1) {
+          close(fd);
+        }
+      }
+#endif
+    }
+
+    bool is_valid() const
+    {
+      return mLeader != -1;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+      if ( ! is_valid()) {
+        return;
+      }
+      ioctl(mLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(mLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Stops counting and returns the counts since the last call to start()
+    perf_counts stop()
+    {
+      auto result = perf_counts {};
+#ifdef __linux__
+      if ( ! is_valid()) {
+        return result;
+      }
+      ioctl(mLeader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      // Layout given by PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_*:
+      // nr, time_enabled, time_running, {value, id} * nr
+      auto buffer = std::array<uint64_t, 3 + 2 * perf_counts::NUM_EVENTS> {};
+      if (read(mLeader, buffer.data(), sizeof(buffer)) <= 0) {
+        return result;
+      }
+      auto nr = buffer[0];
+      auto enabled = buffer[1];
+      auto running = buffer[2];
+      auto scale = running == 0 ? 0.0 : (double) enabled / running;
+      for (size_t vi = 0; vi < nr && vi < perf_counts::NUM_EVENTS; ++vi) {
+        auto value = buffer[3 + 2 * vi];
+        auto id = buffer[3 + 2 * vi + 1];
+        for (size_t idx = 0; idx < perf_counts::NUM_EVENTS; ++idx) {
+          if (mFds[idx] != -1 && mIds[idx] == id) {
+            result.counts[idx] = (uint64_t) (value * scale);
+            result.available[idx] = true;
+          }
+        }
+      }
+#endif
+      return result;
+    }
+
+  private:
+#ifdef __linux__
+    static
+    void set_event(perf_event_attr& pAttr, perf_counts::event pEvent)
+    {
+      pAttr.type = PERF_TYPE_HARDWARE;
+      switch (pEvent) {
+      case perf_counts::CYCLES: pAttr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+      case perf_counts::INSTRUCTIONS: pAttr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+      case perf_counts::CACHE_MISSES: pAttr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+      case perf_counts::BRANCH_MISSES: pAttr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+      case perf_counts::DTLB_LOAD_MISSES:
+        pAttr.type = PERF_TYPE_HW_CACHE;
+        pAttr.config =
+          PERF_COUNT_HW_CACHE_DTLB |
+          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+      default: break;
+      }
+    }
+#endif
+
+    int mLeader = -1;
+    std::array<int, perf_counts::NUM_EVENTS> mFds;
+    std::array<uint64_t, perf_counts::NUM_EVENTS> mIds {};
+  };
+}} // namespace
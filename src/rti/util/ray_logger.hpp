@@ -1,74 +1,273 @@
 #pragma once
 
-// a logger for the rays we are using
+// A logger for the rays we are using
 //
-// NOT THREAD SAVE: use with a single thread only!
-// CAUSES SEGMENTATION FAULT WHEN USED IN MULTIPLE THREADS.
+// Thread safe: every thread appends to its own buffer. A buffer is written to
+// the log file when it is full (or when flush() is called), so the memory used
+// by the logger is bounded. The log is a compact binary file; use the
+// executable rti-ray-log-to-vtp (see main/ray_log_to_vtp.cpp) to convert it
+// into .vtp files for Paraview.
 //
+// The logger is enabled at runtime with open(). When it is disabled every
+// logging call costs a single (predictable) branch.
+//
+// Sampling: only every k-th ray (with respect to the ray index) is logged.
+// If a set of primitive IDs is given, then only those of the sampled rays
+// are logged which hit at least one of the primitives in the set.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <embree3/rtcore.h>
 
 #include "utils.hpp"
 
 namespace rti { namespace util {
-//
-// #define RAYLOG_ON
-// #define RAYSRCLOG_ON
-
-  // vector of 3D line segments
-  static auto sRayLogVec = std::vector<rti::util::pair<rti::util::triple<float> > > {};
-  // vector of 3D points
-  static auto sPointLogVec = std::vector<rti::util::triple<float> > {};
-  static constexpr auto sLineMaxLength = 64.f;
-
-
-#ifdef RAYLOG_ON
-    //auto tfar = std::min((rh).ray.tfar, rti::util::sLineMaxLength);
-    //
-    // This macro expects a semicolon at the end
-#define RAYLOG(rh, tfar)                             \
-  { \
-    auto p1 = rti::util::triple<float> {(rh).ray.org_x, (rh).ray.org_y, (rh).ray.org_z}; \
-    tfar = ((tfar) > 10 ? 10 : (tfar));                                 \
-    auto p2 = rti::util::triple<float> {p1[0] + tfar * (rh).ray.dir_x,  \
-                                        p1[1] + tfar * (rh).ray.dir_y,  \
-                                        p1[2] + tfar * (rh).ray.dir_z}; \
-    rti::util::sRayLogVec.push_back({p1, p2}); \
-  } \
-  do {} while(false) // allows us to put a semicolon after the macro (without warnings)
-#else
-#define RAYLOG(rh, tfar)                                                     \
-  do {} while(false) // allows us to put a semicolon after the macro (without warnings)
-#endif
-
-
-#ifdef RAYLOG_ON
-    // This macro expects a semicolon at the end
-#define RAYLOG_GET_PTR() \
-    [](){return &rti::util::sRayLogVec;}()
-#else
-#define RAYLOG_GET_PTR() \
-    [](){return (std::vector<rti::util::pair<rti::util::triple<float> > >*) nullptr;}()
-#endif
-
-
-#ifdef RAYSRCLOG_ON
-#define RAYSRCLOG(rh) \
-  { \
-  rti::util::sPointLogVec.push_back({rh.ray.org_x, rh.ray.org_y, rh.ray.org_z}); \
-  } \
-  do {} while(false) // allows to put a semicolon after macro (without warnings)
-#else
-#define RAYSRCLOG(rh) \
-  do {} while(false) // allows to put a semicolon after macro (without warnings)
-#endif
-
-
-#ifdef RAYSRCLOG_ON
-#define RAYSRCLOG_GET_PTR(rh) \
-  [](){return &rti::util::sPointLogVec;}()
-#else
-#define RAYSRCLOG_GET_PTR(rh) \
-  [](){return (std::vector<rti::util::triple<float> >*)  nullptr;}()
-#endif
 
+  class ray_logger {
+
+  public:
+
+    enum class record_kind : uint32_t {
+      SEGMENT = 0, // a 3D line segment
+      SOURCE = 1   // a 3D point; p2 is unused
+    };
+
+    // The on-disc format of the log file is a header followed by a sequence of
+    // records. Everything is written in the byte order of the host.
+    struct header {
+      char magic[8];
+      uint32_t version;
+      uint32_t recordsize;
+    };
+
+    struct record {
+      uint32_t kind;
+      float p1[3];
+      float p2[3];
+    };
+
+    static constexpr char const* sMagic = "RTIRAYLG";
+    static constexpr uint32_t sVersion = 1;
+    // Rays which do not hit anything are logged with this length
+    static constexpr float sLineMaxLength = 64.f;
+
+    // Not thread safe; call outside of parallel regions only.
+    static
+    bool open(std::string const& pFilename,
+              size_t pEvery = 1,
+              std::unordered_set<unsigned int> pPrimIDs = {})
+    {
+      close();
+      auto& ll = instance();
+      ll.mOut.open(pFilename, std::ios::binary | std::ios::trunc);
+      if ( ! ll.mOut ) {
+        return false;
+      }
+      auto hh = header {};
+      std::copy(sMagic, sMagic + sizeof(hh.magic), hh.magic);
+      hh.version = sVersion;
+      hh.recordsize = sizeof(record);
+      ll.mOut.write(reinterpret_cast<char const*>(&hh), sizeof(hh));
+      ll.mFilename = pFilename;
+      ll.mEvery = pEvery == 0 ? 1 : pEvery;
+      ll.mPrimIDs = std::move(pPrimIDs);
+      ll.mGeneration += 1;
+      sEnabled.store(true, std::memory_order_release);
+      return true;
+    }
+
+    // Not thread safe; call outside of parallel regions only.
+    static
+    void close()
+    {
+      if ( ! is_enabled()) {
+        return;
+      }
+      flush();
+      auto& ll = instance();
+      sEnabled.store(false, std::memory_order_release);
+      ll.mOut.close();
+      ll.mBuffers.clear();
+    }
+
+    // Writes the content of all thread buffers to the log file.
+    // Not thread safe; call outside of parallel regions only.
+    static
+    void flush()
+    {
+      if ( ! is_enabled()) {
+        return;
+      }
+      auto& ll = instance();
+      for (auto& buffer : ll.mBuffers) {
+        ll.write(*buffer);
+      }
+      ll.mOut.flush();
+    }
+
+    static
+    bool is_enabled()
+    {
+      return sEnabled.load(std::memory_order_relaxed);
+    }
+
+    static
+    std::string get_file_name()
+    {
+      return instance().mFilename;
+    }
+
+    //// The following functions are thread safe.
+
+    static
+    void begin_ray(size_t pRayIdx)
+    {
+      if ( ! is_enabled()) {
+        return;
+      }
+      auto& buffer = thread_buffer();
+      auto& ll = instance();
+      buffer.mActive = pRayIdx % ll.mEvery == 0;
+      buffer.mKeep = ll.mPrimIDs.empty();
+      buffer.mPending.clear();
+    }
+
+    static
+    void log_segment(RTCRay const& pRay)
+    {
+      if ( ! is_enabled()) {
+        return;
+      }
+      auto& buffer = thread_buffer();
+      if ( ! buffer.mActive) {
+        return;
+      }
+      auto tfar = pRay.tfar > sLineMaxLength ? sLineMaxLength : pRay.tfar;
+      buffer.mPending.push_back
+        ({(uint32_t) record_kind::SEGMENT,
+          {pRay.org_x, pRay.org_y, pRay.org_z},
+          {pRay.org_x + tfar * pRay.dir_x,
+           pRay.org_y + tfar * pRay.dir_y,
+           pRay.org_z + tfar * pRay.dir_z}});
+    }
+
+    static
+    void log_source(RTCRay const& pRay)
+    {
+      if ( ! is_enabled()) {
+        return;
+      }
+      auto& buffer = thread_buffer();
+      if ( ! buffer.mActive) {
+        return;
+      }
+      buffer.mPending.push_back
+        ({(uint32_t) record_kind::SOURCE, {pRay.org_x, pRay.org_y, pRay.org_z}, {0, 0, 0}});
+    }
+
+    static
+    void log_hit(unsigned int pPrimID)
+    {
+      if ( ! is_enabled()) {
+        return;
+      }
+      auto& buffer = thread_buffer();
+      if ( ! buffer.mActive || buffer.mKeep) {
+        return;
+      }
+      auto& primids = instance().mPrimIDs;
+      buffer.mKeep = primids.find(pPrimID) != primids.end();
+    }
+
+    static
+    void end_ray()
+    {
+      if ( ! is_enabled()) {
+        return;
+      }
+      auto& buffer = thread_buffer();
+      if (buffer.mActive && buffer.mKeep) {
+        buffer.mRecords.insert(buffer.mRecords.end(), buffer.mPending.begin(), buffer.mPending.end());
+        if (buffer.mRecords.size() >= sBufferCapacity) {
+          instance().write(buffer);
+        }
+      }
+      buffer.mActive = false;
+      buffer.mPending.clear();
+    }
+
+  private:
+
+    struct thread_buffer_t {
+      std::vector<record> mRecords;
+      // the records of the current ray
+      std::vector<record> mPending;
+      bool mActive = false;
+      bool mKeep = false;
+    };
+
+    static
+    ray_logger& instance()
+    {
+      static ray_logger sInstance;
+      return sInstance;
+    }
+
+    static
+    thread_buffer_t& thread_buffer()
+    {
+      // The generation changes whenever the log is reopened. In that case the
+      // thread registers a new buffer.
+      thread_local thread_buffer_t* tBuffer = nullptr;
+      thread_local uint64_t tGeneration = 0;
+      auto& ll = instance();
+      if (tBuffer == nullptr || tGeneration != ll.mGeneration) {
+        auto lock = std::lock_guard<std::mutex> {ll.mMutex};
+        ll.mBuffers.push_back(std::make_unique<thread_buffer_t>());
+        tBuffer = ll.mBuffers.back().get();
+        tBuffer->mRecords.reserve(sBufferCapacity);
+        tGeneration = ll.mGeneration;
+      }
+      return *tBuffer;
+    }
+
+    void write(thread_buffer_t& pBuffer)
+    {
+      auto lock = std::lock_guard<std::mutex> {mMutex};
+      mOut.write(reinterpret_cast<char const*>(pBuffer.mRecords.data()),
+                 pBuffer.mRecords.size() * sizeof(record));
+      pBuffer.mRecords.clear();
+    }
+
+    // magic number; number of records per thread buffer (28 bytes each)
+    static constexpr size_t sBufferCapacity = 1 << 15;
+
+    inline static std::atomic<bool> sEnabled {false};
+
+    std::mutex mMutex;
+    std::ofstream mOut;
+    std::string mFilename;
+    std::vector<std::unique_ptr<thread_buffer_t> > mBuffers;
+    uint64_t mGeneration = 0;
+    size_t mEvery = 1;
+    std::unordered_set<unsigned int> mPrimIDs;
+  };
+
+  static_assert(sizeof(ray_logger::record) == 28, "Assumption: records are packed");
+
+// These macros expect a semicolon at the end
+#define RAYLOG_BEGIN(rayidx) rti::util::ray_logger::begin_ray(rayidx)
+#define RAYLOG(rh) rti::util::ray_logger::log_segment((rh).ray)
+#define RAYSRCLOG(rh) rti::util::ray_logger::log_source((rh).ray)
+#define RAYLOG_HIT(primid) rti::util::ray_logger::log_hit(primid)
+#define RAYLOG_END() rti::util::ray_logger::end_ray()
 
 }}
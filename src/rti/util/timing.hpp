@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "timer.hpp"
+#include "utils.hpp"
+
+namespace rti { namespace util {
+
+  // A tree of named wall clock durations. Every entry may have nested entries
+  // (e.g., "trace" -> "scene-commit"). The durations of nested entries are
+  // included in the duration of their parent.
+  class timing_record {
+  public:
+    timing_record(std::string pName = "total") :
+      mName(pName) {}
+
+    // Returns the nested entry with the given name; creates it if necessary.
+    // References to nested entries stay valid when further entries are added.
+    timing_record& child(std::string const& pName)
+    {
+      for (auto& cc : mChildren) {
+        if (cc.mName == pName) {
+          return cc;
+        }
+      }
+      mChildren.emplace_back(pName);
+      return mChildren.back();
+    }
+
+    // Adds the durations of pOther (and of its nested entries) to the nested
+    // entry of the same name.
+    void merge(timing_record const& pOther)
+    {
+      auto& cc = child(pOther.mName);
+      cc.mNanoseconds += pOther.mNanoseconds;
+      for (auto const& oc : pOther.mChildren) {
+        cc.merge(oc);
+      }
+    }
+
+    void add_nanoseconds(uint64_t pNanoseconds)
+    {
+      mNanoseconds += pNanoseconds;
+    }
+
+    uint64_t get_nanoseconds() const
+    {
+      return mNanoseconds;
+    }
+
+    std::string const& get_name() const
+    {
+      return mName;
+    }
+
+    std::list<timing_record> const& get_children() const
+    {
+      return mChildren;
+    }
+
+    // Returns the entries as key-value pairs with keys of the form
+    // "timing/trace/scene-commit[ns]" (for use as meta data).
+    std::vector<util::pair<std::string> > flatten(std::string const& pPrefix = "timing") const
+    {
+      auto result = std::vector<util::pair<std::string> > {};
+      flatten(pPrefix, result);
+      return result;
+    }
+
+    void print(std::ostream& pOs, size_t pIndent = 0) const
+    {
+      pOs << std::string(2 * pIndent, ' ') << mName << ": " << mNanoseconds * 1e-9 << " seconds" << std::endl;
+      for (auto const& cc : mChildren) {
+        cc.print(pOs, pIndent + 1);
+      }
+    }
+
+  private:
+    void flatten(std::string const& pPrefix, std::vector<util::pair<std::string> >& pResult) const
+    {
+      for (auto const& cc : mChildren) {
+        auto key = pPrefix + "/" + cc.mName;
+        pResult.push_back({key + "[ns]", std::to_string(cc.mNanoseconds)});
+        cc.flatten(key, pResult);
+      }
+    }
+
+    std::string mName;
+    uint64_t mNanoseconds = 0;
+    std::list<timing_record> mChildren;
+  };
+
+  // Measures the time from its construction until its destruction (or until
+  // stop() is called) and adds it to a timing record.
+  class timing_probe {
+  public:
+    timing_probe(timing_record& pRecord) :
+      mRecord(pRecord) {}
+
+    timing_probe(timing_probe const&) = delete;
+    timing_probe& operator=(timing_probe const&) = delete;
+
+    ~timing_probe()
+    {
+      stop();
+    }
+
+    void stop()
+    {
+      if (mStopped) {
+        return;
+      }
+      mRecord.add_nanoseconds(mTimer.elapsed_nanoseconds());
+      mStopped = true;
+    }
+
+  private:
+    timing_record& mRecord;
+    util::timer mTimer;
+    bool mStopped = false;
+  };
+}} // namespace
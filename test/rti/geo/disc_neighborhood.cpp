@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "rti/geo/disc_neighborhood.hpp"
+
+using namespace rti;
+using numeric_type = float;
+
+static
+void assert_equal_to_naive(std::vector<util::quadruple<numeric_type> >& points)
+{
+  auto min = util::triple<numeric_type> {1e9, 1e9, 1e9};
+  auto max = util::triple<numeric_type> {-1e9, -1e9, -1e9};
+  for (auto const& pp : points) {
+    for (size_t idx = 0; idx < 3; ++idx) {
+      min[idx] = std::min(min[idx], pp[idx]);
+      max[idx] = std::max(max[idx], pp[idx]);
+    }
+  }
+  auto dac = geo::disc_neighborhood<numeric_type> {};
+  dac.setup_neighborhood(points, min, max);
+  auto naive = geo::disc_neighborhood<numeric_type> {};
+  naive.setup_neighborhood_naive(points);
+  ASSERT_EQ(dac.size(), points.size());
+  for (size_t idx = 0; idx < points.size(); ++idx) {
+    auto nn1 = dac.get_neighbors(idx);
+    auto nn2 = naive.get_neighbors(idx);
+    std::sort(nn1.begin(), nn1.end());
+    std::sort(nn2.begin(), nn2.end());
+    ASSERT_EQ(nn1, nn2) << "neighbors of disc " << idx;
+  }
+}
+
+TEST(disc_neighborhood_test, planar_grid) {
+  // All points on the plane z == 0; the bounding box is flat in z.
+  auto points = std::vector<util::quadruple<numeric_type> > {};
+  for (auto xx = 0; xx < 20; ++xx) {
+    for (auto yy = 0; yy < 20; ++yy) {
+      points.push_back({(numeric_type) xx, (numeric_type) yy, 0, 1});
+    }
+  }
+  assert_equal_to_naive(points);
+  // Each inner disc overlaps with the discs at a distance smaller than 2.
+  auto nbhd = geo::disc_neighborhood<numeric_type> {};
+  auto min = util::triple<numeric_type> {0, 0, 0};
+  auto max = util::triple<numeric_type> {19, 19, 0};
+  nbhd.setup_neighborhood(points, min, max);
+  ASSERT_EQ(nbhd.get_neighbors(10 * 20 + 10).size(), 8u);
+}
+
+TEST(disc_neighborhood_test, random_cloud) {
+  auto rng = std::mt19937_64 {42};
+  auto dist = std::uniform_real_distribution<numeric_type> {0, 10};
+  auto points = std::vector<util::quadruple<numeric_type> > {};
+  for (auto idx = 0; idx < 1000; ++idx) {
+    points.push_back({dist(rng), dist(rng), dist(rng) / 10, 0.5});
+  }
+  assert_equal_to_naive(points);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rti/io/batch_manifest.hpp"
+
+using namespace rti;
+
+TEST(batch_manifest_test, reads_jobs_with_defaults) {
+  auto in = std::istringstream {
+    "# input output parameters\n"
+    "\n"
+    "a.rtipc a-out.vtp\n"
+    "  b.vtp b-out.vtp sticking-coefficient=0.25 number-of-rays=1000 repetitions=3\n"
+    "c.vtp c-out time-budget=2.5\n"};
+  auto defaults = io::batch_job {};
+  defaults.stickingC = 0.5f;
+  auto jobs = std::vector<io::batch_job> {};
+  auto error = std::string {};
+  ASSERT_TRUE(io::batch_manifest::read(in, defaults, jobs, error));
+  ASSERT_EQ(jobs.size(), 3u);
+  ASSERT_EQ(jobs[0].infile, "a.rtipc");
+  ASSERT_EQ(jobs[0].outfile, "a-out.vtp");
+  ASSERT_EQ(jobs[0].stickingC, 0.5f);
+  ASSERT_EQ(jobs[0].numRays, 0u);
+  ASSERT_EQ(jobs[1].stickingC, 0.25f);
+  ASSERT_EQ(jobs[1].numRays, 1000u);
+  ASSERT_EQ(jobs[1].repetitions, 3u);
+  ASSERT_EQ(jobs[2].timeBudget, 2.5);
+
+  ASSERT_EQ(io::batch_manifest::get_outfile(jobs[0], 0), "a-out.vtp");
+  ASSERT_EQ(io::batch_manifest::get_outfile(jobs[1], 2), "b-out.2.vtp");
+  ASSERT_EQ(io::batch_manifest::get_outfile(jobs[2], 0), "c-out.vtp");
+  jobs[2].repetitions = 2;
+  ASSERT_EQ(io::batch_manifest::get_outfile(jobs[2], 1), "c-out.1.vtp");
+}
+
+TEST(batch_manifest_test, rejects_malformed_lines) {
+  for (auto const& line : {"a.vtp\n", "a.vtp b.vtp rays=10\n", "a.vtp b.vtp number-of-rays=1x\n",
+                           "a.vtp b.vtp sticking-coefficient=0\n", "a.vtp b.vtp repetitions=0\n"}) {
+    auto in = std::istringstream {line};
+    auto jobs = std::vector<io::batch_job> {};
+    auto error = std::string {};
+    ASSERT_FALSE(io::batch_manifest::read(in, io::batch_job {}, jobs, error)) << line;
+    ASSERT_EQ(error.find("line 1"), 0u);
+  }
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "rti/io/rtipc_format.hpp"
+#include "rti/io/rtipc_point_cloud_reader.hpp"
+
+using namespace rti;
+
+TEST(rtipc_point_cloud_reader_test, round_trip) {
+  auto filename = std::string {"rtipc_point_cloud_reader_test.rtipc"};
+  auto points = std::vector<util::quadruple<float> >
+    {{0, 0, 0, 0.5f}, {1, 2, -3, 0.25f}, {-4, 5, 6, 1}};
+  auto normals = std::vector<util::triple<float> >
+    {{0, 0, 1}, {1, 0, 0}, {0, -1, 0}};
+  ASSERT_TRUE(io::rtipc_format::write<float>(points, normals, filename));
+
+  auto reader = io::rtipc_point_cloud_reader<float> {filename};
+  ASSERT_TRUE(reader.is_valid());
+  ASSERT_EQ(reader.get_num_points(), points.size());
+  ASSERT_EQ(reader.get_points(), points);
+  ASSERT_EQ(reader.get_normals(), normals);
+  ASSERT_EQ(reader.get_min(), (util::triple<float> {-4, 0, -3}));
+  ASSERT_EQ(reader.get_max(), (util::triple<float> {1, 5, 6}));
+  ASSERT_EQ(reader.get_max_radius(), 1);
+  // Embree requires (at least) 4 byte aligned buffers
+  ASSERT_EQ((uintptr_t) reader.get_point_buffer() % 16, 0u);
+  ASSERT_EQ((uintptr_t) reader.get_normal_buffer() % 16, 0u);
+  std::remove(filename.c_str());
+}
+
+TEST(rtipc_point_cloud_reader_test, rejects_other_files) {
+  auto filename = std::string {"rtipc_point_cloud_reader_test.vtp"};
+  {
+    auto out = std::ofstream {filename};
+    out << "<?xml version=\"1.0\"?>" << std::string(256, ' ') << std::endl;
+  }
+  auto reader = io::rtipc_point_cloud_reader<float> {filename};
+  ASSERT_FALSE(reader.is_valid());
+  ASSERT_EQ(reader.get_num_points(), 0u);
+  std::remove(filename.c_str());
+}
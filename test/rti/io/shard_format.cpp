@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "rti/io/shard_format.hpp"
+#include "rti/trace/hit_accumulator.hpp"
+
+using namespace rti;
+
+TEST(shard_format_test, merged_shards_equal_single_run) {
+  auto areas = std::vector<float> {1, 2, 3};
+  auto single = trace::hit_accumulator<float> {3};
+  auto shard0 = trace::hit_accumulator<float> {3};
+  auto shard1 = trace::hit_accumulator<float> {3};
+  auto samples = std::vector<std::pair<unsigned int, float> >
+    {{0, 0.5f}, {2, 0.25f}, {0, 1}, {1, 0.125f}, {2, 0.75f}};
+  for (size_t idx = 0; idx < samples.size(); ++idx) {
+    single.use(samples[idx].first, samples[idx].second);
+    (idx % 2 == 0 ? shard0 : shard1).use(samples[idx].first, samples[idx].second);
+  }
+  for (auto* acc : {&single, &shard0, &shard1}) {
+    acc->set_exposed_areas(areas);
+  }
+  auto filename0 = std::string {"shard_format_test.0.rtishard"};
+  auto filename1 = std::string {"shard_format_test.1.rtishard"};
+  ASSERT_TRUE(io::shard_format::write(shard0, 3, 0, 2, filename0));
+  ASSERT_TRUE(io::shard_format::write(shard1, 2, 1, 2, filename1));
+
+  auto hh0 = io::shard_format::header {};
+  auto hh1 = io::shard_format::header {};
+  auto read0 = io::shard_format::read<float>(filename0, hh0);
+  auto read1 = io::shard_format::read<float>(filename1, hh1);
+  ASSERT_TRUE(read0 && read1);
+  ASSERT_EQ(hh0.numrays, 3u);
+  ASSERT_EQ(hh1.shardindex, 1u);
+  ASSERT_EQ(hh1.numshards, 2u);
+
+  auto merged = trace::hit_accumulator<float> {*read0, *read1};
+  ASSERT_EQ(merged.get_cnts(), single.get_cnts());
+  ASSERT_EQ(merged.get_cnts_sum(), single.get_cnts_sum());
+  ASSERT_EQ(merged.get_exposed_areas(), areas);
+  // The samples are exact in binary; hence, the sums are equal.
+  ASSERT_EQ(merged.get_values(), single.get_values());
+  ASSERT_EQ(merged.get_s4s(), single.get_s4s());
+  ASSERT_EQ(merged.get_relative_error(), single.get_relative_error());
+  ASSERT_EQ(merged.get_vov(), single.get_vov());
+  std::remove(filename0.c_str());
+  std::remove(filename1.c_str());
+}
+
+TEST(shard_format_test, rejects_other_files) {
+  auto hh = io::shard_format::header {};
+  ASSERT_EQ(io::shard_format::read<float>("shard_format_test.does-not-exist", hh), nullptr);
+}
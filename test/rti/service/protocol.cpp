@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "rti/service/protocol.hpp"
+
+using namespace rti;
+
+namespace {
+  using protocol = service::protocol;
+
+  struct socket_pair {
+    socket_pair()
+    {
+      ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    }
+    ~socket_pair()
+    {
+      ::close(fds[0]);
+      ::close(fds[1]);
+    }
+    int fds[2] = {-1, -1};
+  };
+}
+
+TEST(service_protocol_test, transfers_requests_and_responses) {
+  auto sockets = socket_pair {};
+  auto request = protocol::request {};
+  request.xcond = protocol::sPeriodic;
+  request.stickingc = 0.25f;
+  request.numrays = 1000;
+  request.timebudget = 1.5;
+  request.points = {0, 0, 0, 1, 0, 0};
+  request.normals = {0, 0, 1, 0, 0, 1};
+  request.spacings = {0.5f};
+  auto reuse = request;
+  reuse.flags = protocol::sReuseGeometry;
+  reuse.points.clear();
+  reuse.stickingc = 0.5f;
+
+  // The writes do not block on the reads of the same thread (small messages)
+  ASSERT_TRUE(protocol::write_request(sockets.fds[0], request));
+  ASSERT_TRUE(protocol::write_request(sockets.fds[0], reuse));
+  auto received = protocol::request {};
+  ASSERT_TRUE(protocol::read_request(sockets.fds[1], received));
+  ASSERT_EQ(received.flags, 0u);
+  ASSERT_EQ(received.xcond, protocol::sPeriodic);
+  ASSERT_EQ(received.ycond, protocol::sReflective);
+  ASSERT_EQ(received.numrays, 1000u);
+  ASSERT_EQ(received.timebudget, 1.5);
+  ASSERT_EQ(received.points, request.points);
+  ASSERT_EQ(received.normals, request.normals);
+  ASSERT_EQ(received.spacings, request.spacings);
+  // The geometry of the previous request remains
+  ASSERT_TRUE(protocol::read_request(sockets.fds[1], received));
+  ASSERT_EQ(received.flags, protocol::sReuseGeometry);
+  ASSERT_EQ(received.stickingc, 0.5f);
+  ASSERT_EQ(received.points, request.points);
+
+  auto response = protocol::response {};
+  response.numrays = 1000;
+  response.mcestimates = {1, 0.5f};
+  response.hitcnts = {7, 3};
+  ASSERT_TRUE(protocol::write_response(sockets.fds[1], response));
+  auto rejected = protocol::response {};
+  rejected.stat = protocol::status::NO_GEOMETRY;
+  ASSERT_TRUE(protocol::write_response(sockets.fds[1], rejected));
+  auto answer = protocol::response {};
+  ASSERT_TRUE(protocol::read_response(sockets.fds[0], answer));
+  ASSERT_EQ(answer.stat, protocol::status::OK);
+  ASSERT_EQ(answer.numrays, 1000u);
+  ASSERT_EQ(answer.mcestimates, response.mcestimates);
+  ASSERT_EQ(answer.hitcnts, response.hitcnts);
+  ASSERT_TRUE(protocol::read_response(sockets.fds[0], answer));
+  ASSERT_EQ(answer.stat, protocol::status::NO_GEOMETRY);
+  ASSERT_TRUE(answer.mcestimates.empty());
+}
+
+TEST(service_protocol_test, rejects_malformed_messages) {
+  auto sockets = socket_pair {};
+  auto request = protocol::request {};
+  request.points = {0, 0, 0, 1, 0, 0};
+  request.normals = {0, 0, 1};
+  request.spacings = {0.5f};
+  // Fewer normals than points
+  ASSERT_FALSE(protocol::write_request(sockets.fds[0], request));
+  // No points; the server would wait for the grid spacing otherwise
+  request.points.clear();
+  request.normals.clear();
+  ASSERT_FALSE(protocol::write_request(sockets.fds[0], request));
+  auto header = protocol::request_header {};
+  std::memcpy(header.magic, protocol::sRequestMagic, sizeof(header.magic));
+  header.version = protocol::sVersion;
+  header.headersize = sizeof(header);
+  header.numpoints = 0;
+  header.numspacings = 1;
+  ASSERT_EQ(::send(sockets.fds[0], &header, sizeof(header), 0), (ssize_t) sizeof(header));
+  auto received = protocol::request {};
+  ASSERT_FALSE(protocol::read_request(sockets.fds[1], received));
+  // A response is not a request
+  ASSERT_TRUE(protocol::write_response(sockets.fds[0], protocol::response {}));
+  ASSERT_FALSE(protocol::read_request(sockets.fds[1], received));
+  // A closed connection
+  ::shutdown(sockets.fds[0], SHUT_WR);
+  ASSERT_FALSE(protocol::read_request(sockets.fds[1], received));
+}
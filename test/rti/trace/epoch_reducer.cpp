@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rti/io/checkpoint_format.hpp"
+#include "rti/trace/epoch_reducer.hpp"
+
+using namespace rti;
+
+namespace {
+  using accumulator_type = trace::hit_accumulator<float>;
+
+  // Every thread drops value (thread + 1) * (epoch + 1) / 8 on primitive epoch % 3
+  void trace_epochs(trace::epoch_reducer<float>& pReducer, size_t pThread,
+                    uint64_t pFirstEpoch, uint64_t pNumEpochs)
+  {
+    auto progress = pReducer.get_progress(pThread);
+    auto acc = std::make_unique<accumulator_type>(3);
+    for (auto epoch = pFirstEpoch; epoch < pNumEpochs; ++epoch) {
+      acc->use(epoch % 3, (pThread + 1) * (epoch + 1) / 8.0f);
+      progress.raysdone += 1;
+      progress.hitc += 1;
+      acc = pReducer.submit(pThread, epoch, std::move(acc), progress, epoch + 1 < pNumEpochs);
+    }
+  }
+
+  std::unique_ptr<accumulator_type>
+  run(trace::epoch_reducer<float>& pReducer, size_t pNumThreads, uint64_t pNumEpochs)
+  {
+    auto firstepoch = pReducer.get_num_epochs();
+    auto threads = std::vector<std::thread> {};
+    for (size_t tt = 0; tt < pNumThreads; ++tt) {
+      threads.emplace_back(trace_epochs, std::ref(pReducer), tt, firstepoch, pNumEpochs);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return pReducer.take_result();
+  }
+}
+
+TEST(epoch_reducer_test, sums_all_epochs) {
+  auto reducer = trace::epoch_reducer<float> {3, 4};
+  auto numcallbacks = 0u;
+  reducer.set_on_epoch([&](uint64_t pEpochs, accumulator_type&, std::vector<trace::thread_progress> const& pProgress) {
+      numcallbacks += 1;
+      ASSERT_EQ(pEpochs, numcallbacks);
+      for (auto const& pp : pProgress) {
+        ASSERT_EQ(pp.raysdone, pEpochs);
+      }
+    });
+  auto result = run(reducer, 4, 7);
+  ASSERT_EQ(numcallbacks, 7u);
+  ASSERT_EQ(result->get_cnts_sum(), 28u);
+  ASSERT_EQ(result->get_cnts(), (std::vector<size_t> {12, 8, 8}));
+  // (1 + 2 + 3 + 4) * (1 + 4 + 7) / 8
+  ASSERT_EQ(result->get_values()[0], 15.0);
+}
+
+TEST(epoch_reducer_test, resumes_from_checkpoint) {
+  auto filename = std::string {"epoch_reducer_test.rtickpt"};
+  auto uninterrupted = trace::epoch_reducer<float> {3, 2};
+  auto expected = run(uninterrupted, 2, 5);
+
+  // Write a checkpoint after epoch 2 and stop there
+  auto interrupted = trace::epoch_reducer<float> {3, 2};
+  interrupted.set_on_epoch([&](uint64_t pEpochs, accumulator_type& pAcc, std::vector<trace::thread_progress> const& pProgress) {
+      if (pEpochs == 2) {
+        ASSERT_TRUE(io::checkpoint_format::write(filename, 10, 1, pEpochs, pAcc, pProgress));
+      }
+    });
+  run(interrupted, 2, 2);
+
+  auto content = io::checkpoint_format::content<float> {};
+  ASSERT_TRUE(io::checkpoint_format::read(filename, content));
+  ASSERT_EQ(content.hh.numepochs, 2u);
+  ASSERT_EQ(content.hh.numthreads, 2u);
+  auto resumed = trace::epoch_reducer<float> {3, 2};
+  resumed.restore(std::move(content.acc), content.hh.numepochs, std::move(content.progress));
+  auto result = run(resumed, 2, 5);
+  ASSERT_EQ(result->get_cnts(), expected->get_cnts());
+  ASSERT_EQ(result->get_values(), expected->get_values());
+  ASSERT_EQ(result->get_s2s(), expected->get_s2s());
+  ASSERT_EQ(resumed.get_progress(1).raysdone, 5u);
+  std::remove(filename.c_str());
+}
+
+TEST(epoch_reducer_test, completes_epochs_without_finished_threads) {
+  auto reducer = trace::epoch_reducer<float> {3, 3};
+  auto lastepochs = 0u;
+  reducer.set_on_epoch([&](uint64_t pEpochs, accumulator_type&, std::vector<trace::thread_progress> const&) {
+      lastepochs = pEpochs;
+    });
+  // Thread t stops after 2 * t + 1 epochs (e.g., at a deadline)
+  auto threads = std::vector<std::thread> {};
+  for (size_t tt = 0; tt < 3; ++tt) {
+    threads.emplace_back(trace_epochs, std::ref(reducer), tt, 0, 2 * tt + 1);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto result = reducer.take_result();
+  ASSERT_EQ(lastepochs, 5u);
+  ASSERT_EQ(result->get_cnts_sum(), 9u);
+  for (size_t tt = 0; tt < 3; ++tt) {
+    ASSERT_EQ(reducer.get_progress(tt).raysdone, 2 * tt + 1);
+  }
+}
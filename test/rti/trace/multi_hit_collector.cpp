@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "rti/trace/multi_hit_collector.hpp"
+
+using namespace rti;
+using numeric_type = float;
+
+TEST(multi_hit_collector_test, unordered_hits) {
+  auto collector = trace::multi_hit_collector<numeric_type> {};
+  collector.clear();
+  ASSERT_TRUE(collector.empty());
+  collector.set_max_eps(1);
+  // Embree reports the candidates in any order
+  ASSERT_TRUE(collector.add(10, 0, 1));
+  ASSERT_TRUE(collector.add(5.5, 1, 1));
+  ASSERT_TRUE(collector.add(5, 2, 1));
+  // Out of range of the closest hit and of any closer one
+  ASSERT_FALSE(collector.add(7, 3, 1));
+  ASSERT_TRUE(collector.add(6, 4, 1));
+  ASSERT_EQ(collector.get_closest().primID, 2u);
+  ASSERT_EQ(collector.get_closest().tfar, 5);
+
+  auto additional = std::vector<unsigned int> {};
+  collector.for_each_additional([&](unsigned int id) { additional.push_back(id); });
+  std::sort(additional.begin(), additional.end());
+  ASSERT_EQ(additional, (std::vector<unsigned int> {1, 4}));
+
+  collector.clear();
+  ASSERT_TRUE(collector.empty());
+  ASSERT_TRUE(collector.add(100, 5, 1));
+}
+
+TEST(multi_hit_collector_test, closer_hit_extends_range) {
+  // Discs with different radii
+  auto collector = trace::multi_hit_collector<numeric_type> {};
+  collector.clear();
+  collector.set_max_eps(4);
+  ASSERT_TRUE(collector.add(5, 0, 1));
+  // Beyond the range of the closest hit so far but not beyond that of a closer one
+  ASSERT_TRUE(collector.add(6.5, 1, 1));
+  ASSERT_FALSE(collector.add(20, 2, 1));
+  ASSERT_TRUE(collector.add(4.5, 3, 3));
+  ASSERT_EQ(collector.get_closest().primID, 3u);
+
+  auto additional = std::vector<unsigned int> {};
+  collector.for_each_additional([&](unsigned int id) { additional.push_back(id); });
+  std::sort(additional.begin(), additional.end());
+  ASSERT_EQ(additional, (std::vector<unsigned int> {0, 1}));
+}
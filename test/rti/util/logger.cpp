@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rti/util/logger.hpp"
+
+using namespace rti;
+
+TEST(logger_test, parse_levels) {
+  auto saved = util::logger::get_levels();
+  ASSERT_TRUE(util::logger::set_levels(std::string {"debug,warning"}));
+  ASSERT_EQ(util::logger::get_levels(), util::log_level::DEBUG | util::log_level::WARNING);
+  ASSERT_TRUE(util::logger::set_levels(std::string {"none"}));
+  ASSERT_EQ(util::logger::get_levels(), util::log_level::NONE);
+  ASSERT_FALSE(util::logger::set_levels(std::string {"info,verbose"}));
+  ASSERT_EQ(util::logger::get_levels(), util::log_level::NONE);
+  util::logger::set_levels(saved);
+}
+
+TEST(logger_test, disabled_level_does_not_evaluate_arguments) {
+  auto saved = util::logger::get_levels();
+  util::logger::set_levels(util::log_level::INFO);
+  auto cnt = 0;
+  auto count = [&cnt] { return ++cnt; };
+  RLOG_DEBUG << count() << std::endl;
+  ASSERT_EQ(cnt, 0);
+  util::logger::set_levels(saved);
+}
+
+TEST(logger_test, writes_to_sink) {
+  auto saved = util::logger::get_levels();
+  auto sink = std::ostringstream {};
+  util::logger::set_sink(sink);
+  util::logger::set_levels(util::log_level::WARNING);
+  RLOG_WARNING << "first " << 1 << std::endl;
+  RLOG_INFO << "second " << 2 << std::endl;
+  RLOG_WARNING << "third " << 3 << std::endl;
+  util::logger::flush();
+  ASSERT_EQ(sink.str(), "first 1\nthird 3\n");
+  util::logger::set_sink(std::cerr);
+  util::logger::set_levels(saved);
+}
+
+TEST(logger_test, nested_statements_and_threads) {
+  auto saved = util::logger::get_levels();
+  auto sink = std::ostringstream {};
+  util::logger::set_sink(sink);
+  util::logger::set_levels(util::log_level::INFO);
+  auto inner = [] {
+    RLOG_INFO << "inner" << std::endl;
+    return 42;
+  };
+  RLOG_INFO << "outer " << inner() << std::endl;
+  util::logger::flush();
+  ASSERT_EQ(sink.str(), "inner\nouter 42\n");
+
+  sink.str(std::string {});
+  auto threads = std::vector<std::thread> {};
+  for (auto tt = 0; tt < 4; ++tt) {
+    threads.emplace_back([] {
+        for (auto ii = 0; ii < 100; ++ii) {
+          RLOG_INFO << "x" << std::endl;
+        }
+      });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  util::logger::flush();
+  // All the messages of the threads, in any order
+  auto msgs = sink.str();
+  ASSERT_EQ(msgs.size(), 800u);
+  ASSERT_EQ(std::count(msgs.begin(), msgs.end(), 'x'), 400);
+  util::logger::set_sink(std::cerr);
+  util::logger::set_levels(saved);
+}
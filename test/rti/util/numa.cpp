@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <sched.h>
+
+#include "rti/util/numa.hpp"
+
+using namespace rti;
+
+TEST(numa_topology_test, parses_cpu_lists) {
+  ASSERT_EQ(util::numa_topology::parse_cpu_list("0-3,8,10-11"), (std::vector<int> {0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_EQ(util::numa_topology::parse_cpu_list("5"), (std::vector<int> {5}));
+  ASSERT_TRUE(util::numa_topology::parse_cpu_list("").empty());
+}
+
+TEST(numa_topology_test, assigns_threads_in_blocks_per_node) {
+  // Two sockets with four CPUs each and an empty node (e.g., memory only)
+  auto topology = util::numa_topology {{{4, 5, 6, 7}, {}, {0, 1, 2, 3}}};
+  ASSERT_EQ(topology.get_num_nodes(), 2u);
+  // Six threads: three per node
+  auto cpus = std::vector<int> {};
+  auto nodes = std::vector<size_t> {};
+  for (size_t tt = 0; tt < 6; ++tt) {
+    cpus.push_back(topology.get_cpu_of_thread(tt, 6));
+    nodes.push_back(topology.get_node_of_thread(tt, 6));
+  }
+  ASSERT_EQ(cpus, (std::vector<int> {4, 5, 6, 0, 1, 2}));
+  ASSERT_EQ(nodes, (std::vector<size_t> {0, 0, 0, 1, 1, 1}));
+  // More threads than CPUs
+  ASSERT_EQ(topology.get_cpu_of_thread(4, 10), 4);
+  ASSERT_EQ(topology.get_cpu_of_thread(9, 10), 0);
+  ASSERT_EQ(topology.get_node_of_cpu(2), 1u);
+  ASSERT_EQ(topology.get_node_of_cpu(7), 0u);
+}
+
+TEST(numa_topology_test, detects_this_machine) {
+  auto const& topology = util::numa_topology::get();
+  ASSERT_GE(topology.get_num_nodes(), 1u);
+  ASSERT_LT(topology.get_current_node(), topology.get_num_nodes());
+}
+
+TEST(numa_topology_test, restores_the_affinity_of_a_pinned_thread) {
+  auto before = cpu_set_t {};
+  ASSERT_EQ(sched_getaffinity(0, sizeof(before), &before), 0);
+  auto const& topology = util::numa_topology::get();
+  {
+    auto pin = util::scoped_thread_pin {topology.get_cpus(0).front()};
+    ASSERT_TRUE(pin.is_pinned());
+    auto pinned = cpu_set_t {};
+    ASSERT_EQ(sched_getaffinity(0, sizeof(pinned), &pinned), 0);
+    ASSERT_EQ(CPU_COUNT(&pinned), 1);
+  }
+  auto after = cpu_set_t {};
+  ASSERT_EQ(sched_getaffinity(0, sizeof(after), &after), 0);
+  ASSERT_TRUE(CPU_EQUAL(&before, &after));
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <string>
+
+#include <omp.h>
+
+#include "rti/io/ray_log_reader.hpp"
+#include "rti/util/ray_logger.hpp"
+
+using namespace rti;
+
+namespace {
+  // Logs a source and a segment per ray from several threads; both carry the
+  // ray index in their x coordinate. Ray idx hits the primitive idx % 10.
+  void log_rays(size_t pNumRays)
+  {
+    #pragma omp parallel for num_threads(8) schedule(dynamic, 64)
+    for (size_t idx = 0; idx < pNumRays; ++idx) {
+      auto ray = RTCRay {};
+      ray.org_x = (float) idx;
+      ray.dir_z = 1;
+      ray.tfar = 1;
+      RAYLOG_BEGIN(idx);
+      util::ray_logger::log_source(ray);
+      util::ray_logger::log_segment(ray);
+      RAYLOG_HIT((unsigned int) (idx % 10));
+      RAYLOG_END();
+    }
+    util::ray_logger::close();
+  }
+
+  std::set<size_t> get_ray_ids(std::string const& pFilename, size_t& pNumSegments)
+  {
+    auto reader = io::ray_log_reader {pFilename};
+    EXPECT_TRUE(reader.is_valid());
+    auto result = std::set<size_t> {};
+    for (auto const& src : reader.get_sources()) {
+      result.insert((size_t) src[0]);
+    }
+    pNumSegments = reader.get_segments().size();
+    for (auto const& seg : reader.get_segments()) {
+      EXPECT_EQ(result.count((size_t) seg[0][0]), 1u);
+    }
+    EXPECT_EQ(result.size(), reader.get_sources().size()) << "a ray is logged twice";
+    return result;
+  }
+}
+
+TEST(ray_logger_test, every_kth_ray_from_many_threads) {
+  auto filename = std::string {"ray_logger_test.every.rtiraylog"};
+  // More records than fit into the buffers of the threads
+  auto numrays = (size_t) 100 * 1000;
+  ASSERT_TRUE(util::ray_logger::open(filename, 3));
+  log_rays(numrays);
+
+  auto in = std::ifstream {filename, std::ios::binary};
+  auto hh = util::ray_logger::header {};
+  ASSERT_TRUE(in.read(reinterpret_cast<char*>(&hh), sizeof(hh)));
+  ASSERT_EQ(std::memcmp(hh.magic, util::ray_logger::sMagic, sizeof(hh.magic)), 0);
+  ASSERT_EQ(hh.version, util::ray_logger::sVersion);
+  ASSERT_EQ(hh.recordsize, sizeof(util::ray_logger::record));
+  in.close();
+
+  auto numsegments = (size_t) 0;
+  auto ids = get_ray_ids(filename, numsegments);
+  ASSERT_EQ(ids.size(), (numrays + 2) / 3);
+  ASSERT_EQ(numsegments, ids.size());
+  for (auto id : ids) {
+    ASSERT_EQ(id % 3, 0u);
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(ray_logger_test, sampled_rays_which_hit_given_primitives) {
+  auto filename = std::string {"ray_logger_test.prims.rtiraylog"};
+  auto numrays = (size_t) 10 * 1000;
+  ASSERT_TRUE(util::ray_logger::open(filename, 3, {7}));
+  log_rays(numrays);
+
+  auto numsegments = (size_t) 0;
+  auto ids = get_ray_ids(filename, numsegments);
+  auto expected = std::set<size_t> {};
+  for (size_t idx = 0; idx < numrays; ++idx) {
+    if (idx % 3 == 0 && idx % 10 == 7) {
+      expected.insert(idx);
+    }
+  }
+  ASSERT_EQ(ids, expected);
+  ASSERT_EQ(numsegments, expected.size());
+  std::remove(filename.c_str());
+}